@@ -0,0 +1,170 @@
+#include "Async.h"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <vector>
+
+#include "../config.h"
+#include "../Buffer/Buffer.h"
+#include "../Daemon/Daemon.h"
+#include "../Prompt/Prompt.h"
+#include "../Reader/Reader.h"
+
+extern char **environ;
+
+/**
+ * Split a target into its parts
+ * @param target The target, as given on the command line
+ * @param path Filled with the path of the FIFO or file the prompt is written to
+ * @param pid Filled with the pid to signal, or 0 if the target is a FIFO
+ * @return false if the target is not valid
+ */
+static bool parse(const string &target, string &path, pid_t &pid) {
+    if (target.starts_with("fifo:")) {
+        path = target.substr(sizeof "fifo:" - 1);
+        pid = 0;
+        return !path.empty();
+    }
+
+    if (target.starts_with("signal:")) {
+        char *end = nullptr;
+        pid = static_cast<pid_t>(std::strtol(target.c_str() + sizeof "signal:" - 1, &end, 10));
+        if (pid <= 0 || *end != ':') { return false; }
+        path = end + 1;
+        return !path.empty();
+    }
+
+    return false;
+}
+
+/**
+ * Write a whole string to a file. A symlink in its place is never followed, so nobody can get us to write to one of
+ * their files.
+ * @param path Path of the file
+ * @param data What to write
+ * @param flags O_TRUNC to replace the file, or O_EXCL to only create a new one
+ * @return true if everything was written
+ */
+static bool writeFile(const string &path, const std::string_view data, const int flags) {
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_NOFOLLOW | O_CLOEXEC | flags, 0600);
+    if (fd == -1) { return false; }
+    const bool ok = write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size());
+    close(fd);
+    return ok;
+}
+
+void Async::start(const string &target, const bool complete, const int argc, char **argv) {
+    string path;
+    pid_t pid;
+    if (!parse(target, path, pid)) {
+        fprintf(stderr, "promptly: invalid async target: %s\n", target.c_str());
+        return;
+    }
+
+    const string token = std::to_string(getpid());
+    const string token_path = path + ".pid";
+
+    // A refresher for an older prompt may still be running. Once this file no longer holds its token, it gives up.
+    if (complete) {
+        unlink(token_path.c_str());
+        return;
+    }
+    if (!writeFile(token_path, token, O_TRUNC)) { return; }
+
+    // promptly --refresh TARGET TOKEN [codes]
+    std::vector<char*> args {argv[0], const_cast<char*>("--refresh"), argv[2], const_cast<char*>(token.c_str())};
+    for (int arg = 3; arg < argc; ++arg) { args.push_back(argv[arg]); }
+    args.push_back(nullptr);
+
+    // The shell is reading our stdout until everyone holding it has closed it, so the refresher must not inherit it.
+    // stdin and stderr stay the same, as they tell the refresher which tty it is on and how wide it is.
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+    // Put it in its own process group, so it doesn't get the signals from the terminal (e.g. ^C) meant for the shell
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    pid_t child;
+    if (const int err = posix_spawn(&child, "/proc/self/exe", &actions, &attr, args.data(), environ); err != 0) {
+        errno = err;
+        perror("promptly: posix_spawn");
+    }
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+}
+
+/**
+ * Check whether a refresher is still the newest one for its shell
+ * @param path Path of the FIFO or file the prompt is written to
+ * @param token The refresher's token
+ * @return false if a newer prompt was rendered since the refresher was started
+ */
+static bool newest(const string &path, const string &token) {
+    char buf[32];
+    return Reader::read(open((path + ".pid").c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC), buf, sizeof buf) == token;
+}
+
+int Async::refresh(Context ctx, const string &target, const string &token) {
+    string path;
+    pid_t pid;
+    if (!parse(target, path, pid)) { return 1; }
+
+    static Buffer out;
+    bool complete = false;
+
+    // The daemon handles one client at a time, so it won't wait on slow collectors for long. It keeps them running
+    // between requests though, so ask again until they have finished.
+    ctx.phase = Context::Phase::Blocking;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ASYNC_TIMEOUT);
+    bool daemon;
+    do {
+        out.clear();
+        daemon = Daemon::request(ctx, out, complete);
+    } while (daemon && !complete && std::chrono::steady_clock::now() < deadline);
+
+    if (!daemon) {
+        out.clear();
+        ctx.phase = Context::Phase::Refresh;
+        complete = Prompt::render(ctx, out);
+    }
+
+    // Without anything new to show, there's no need to redraw
+    if (!complete || !newest(path, token)) { return 0; }
+
+    if (pid == 0) {
+        // A write of up to PIPE_BUF bytes goes into the FIFO in one piece. If nobody has the FIFO open, the shell is
+        // gone, and opening it fails.
+        const int fd = open(path.c_str(), O_WRONLY | O_NONBLOCK | O_NOFOLLOW | O_CLOEXEC);
+        if (fd == -1) { return 1; }
+
+        // zsh only reads the FIFO while a line is being edited, so a prompt written while a command runs is only read
+        // after the next prompt was rendered. The token lets the shell tell that it is out of date.
+        static Buffer message;
+        message.add(token)->add('\n')->add({out.data(), out.size()})->add('\0');
+        const bool ok = message.write(fd);
+        close(fd);
+        return ok ? 0 : 1;
+    }
+
+    // Replace the file in one go, so the shell never reads half of a prompt. The temporary file has to be a new one,
+    // whatever is in its place isn't ours to remove either.
+    const string temp = path + "." + token;
+    if (!writeFile(temp, {out.data(), out.size()}, O_EXCL)) { return 1; }
+    if (rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+        return 1;
+    }
+
+    return kill(pid, SIGUSR1) == 0 ? 0 : 1;
+}
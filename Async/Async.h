@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+
+#include "../Context/Context.h"
+
+using std::string;
+
+/**
+ * Two-phase prompts. promptly --async renders a prompt without waiting on the slow collectors, and if any of them
+ * didn't make it, starts a refresher in the background (promptly --refresh). The refresher renders the prompt again
+ * once they have finished, hands it to the shell and tells the shell to redraw. shell/ holds the shell side of this.
+ *
+ * The shell picks how it is told with a target:
+ *   fifo:PATH          The prompt is written to the FIFO at PATH, after the refresher's token and a newline, and
+ *                      followed by a NUL. zsh watches the FIFO with zle -F.
+ *   signal:PID:PATH    The prompt is written to the file at PATH, and PID is sent SIGUSR1.
+ *
+ * Only the refresher for the newest prompt of a shell tells it anything. PATH.pid holds the pid of the last
+ * promptly --async that started a refresher, and is removed by one that didn't need to.
+ *
+ * The shell keeps PATH in the runtime dir (see promptly --runtime-dir), where nobody else can put a file. Symlinks
+ * are never followed either way.
+ */
+class Async {
+public:
+    /**
+     * Start a refresher for a prompt that was just rendered, or make sure a refresher for an older prompt doesn't
+     * replace it
+     * @param target Where to send the refreshed prompt
+     * @param complete Whether the prompt was complete, in which case nothing is refreshed
+     * @param argc Argument count, as passed to main
+     * @param argv Arguments, as passed to main: promptly --async TARGET [codes]
+     */
+    static void start(const string &target, bool complete, int argc, char **argv);
+
+    /**
+     * Render a prompt once the slow collectors have finished, and send it to the shell
+     * @param ctx The shell to render the prompt for
+     * @param target Where to send the prompt
+     * @param token pid of the promptly --async that started us
+     * @return exit code for the process
+     */
+    static int refresh(Context ctx, const string &target, const string &token);
+};
@@ -0,0 +1,217 @@
+#include "Battery.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../config.h"
+#include "../Reader/Reader.h"
+#include "../Root/Root.h"
+#include "../Runtime/Runtime.h"
+
+using std::string;
+
+// Changes on every boot
+#define BOOT_ID "/proc/sys/kernel/random/boot_id"
+#define SUPPLY_DIR "/sys/class/power_supply/"
+// Largest uevent we will read. They are a few dozen short lines.
+#define UEVENT_BUF 4096
+// How many batteries are read at once. There are rarely more than two.
+#define BAT_BATCH 4
+
+/**
+ * Read the uevent file of a power supply
+ * @param name Name of the supply in /sys/class/power_supply
+ * @param buf Buffer to read into, of UEVENT_BUF bytes
+ * @return The contents of the file, or an empty view if it could not be read
+ */
+static std::string_view readUevent(const string &name, char *buf) {
+    return Reader::read((SUPPLY_DIR + name + "/uevent").c_str(), buf, UEVENT_BUF);
+}
+
+/**
+ * Walk /sys/class/power_supply for batteries. Batteries that only power a device (e.g. a wireless mouse) are left out.
+ * @return The names of the batteries
+ */
+static std::vector<string> discover() {
+    std::vector<string> names;
+
+    DIR *dir = Root::opendir(SUPPLY_DIR);
+    if (dir == nullptr) { return names; }
+
+    char buf[UEVENT_BUF];
+    while (const dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') { continue; }
+
+        const std::string_view uevent = readUevent(entry->d_name, buf);
+        if (Reader::value(uevent, "POWER_SUPPLY_TYPE=") == "Battery" && Reader::value(uevent, "POWER_SUPPLY_SCOPE=") != "Device") {
+            names.emplace_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+
+    // Keep the order the same between boots
+    std::ranges::sort(names);
+    return names;
+}
+
+/**
+ * Load the batteries found earlier in this boot
+ * @param boot Current boot id
+ * @param names Filled with the names of the batteries
+ * @return false if there is no list for this boot, or it is empty and older than BAT_EMPTY_AGE
+ */
+static bool load(const std::string_view boot, std::vector<string> &names) {
+    char buf[UEVENT_BUF];
+    const int fd = Runtime::open(BAT_CACHE_NAME, O_RDONLY);
+    struct stat info {};
+    if (fd != -1) { fstat(fd, &info); }
+    std::string_view list = Reader::read(fd, buf, sizeof buf);
+
+    // The first line is the boot id, followed by a line for every battery
+    if (Reader::line(list) != boot) { return false; }
+    if (list.empty() && time(nullptr) - info.st_mtime > BAT_EMPTY_AGE) { return false; }
+
+    names.clear();
+    while (!list.empty()) { names.emplace_back(Reader::line(list)); }
+    return true;
+}
+
+/**
+ * Save the batteries that were found, for the rest of this boot
+ * @param boot Current boot id
+ * @param names Names of the batteries
+ */
+static void save(const std::string_view boot, const std::vector<string> &names) {
+    string list{boot};
+    list += '\n';
+    for (const string &name : names) { list += name + '\n'; }
+
+    // Write to a temporary file first, so nobody reads half of a list
+    const string temp = BAT_CACHE_NAME "." + std::to_string(getpid());
+
+    const int fd = Runtime::open(temp, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd == -1) { return; }
+    const bool ok = write(fd, list.data(), list.size()) == static_cast<ssize_t>(list.size());
+    close(fd);
+
+    const string temp_path = Runtime::path(temp);
+    if (!ok || rename(temp_path.c_str(), Runtime::path(BAT_CACHE_NAME).c_str()) != 0) { unlink(temp_path.c_str()); }
+}
+
+/**
+ * Get the names of the batteries
+ * @param rescan Look for batteries again, even if they were found earlier in this boot
+ * @return The names of the batteries
+ */
+static std::vector<string> batteries(const bool rescan) {
+    // Found once per process, and once per boot for a process that hasn't looked yet. Finding none is only trusted
+    // for BAT_EMPTY_AGE, so a battery that shows up later isn't missed for the rest of the boot.
+    static std::mutex lock;
+    static std::vector<string> names;
+    static bool found = false;
+    static std::chrono::steady_clock::time_point found_at;
+
+    const std::lock_guard guard(lock);
+    const auto now = std::chrono::steady_clock::now();
+    const bool expired = found && names.empty() && now - found_at > std::chrono::seconds(BAT_EMPTY_AGE);
+    if (found && !rescan && !expired) { return names; }
+
+    char buf[64];
+    std::string_view boot = Reader::read(BOOT_ID, buf, sizeof buf);
+    if (boot.ends_with('\n')) { boot.remove_suffix(1); }
+
+    if (rescan || expired || boot.empty() || !load(boot, names)) {
+        names = discover();
+        if (!boot.empty()) { save(boot, names); }
+    }
+
+    found = true;
+    found_at = now;
+    return names;
+}
+
+std::optional<Battery> Battery::collect() {
+    for (const bool rescan : {false, true}) {
+        // Batteries are combined by how much energy they hold, or by their charge if they don't report energy
+        uint64_t energy_now = 0, energy_full = 0, charge_now = 0, charge_full = 0, capacity = 0;
+        bool energy = true, charge = true, capacities = true, charging = false, full = true, missing = false;
+        size_t count = 0;
+
+        // The batteries are read BAT_BATCH at a time, each batch at once
+        const std::vector<string> names = batteries(rescan);
+        for (size_t start = 0; start < names.size(); start += BAT_BATCH) {
+            const size_t batch = std::min<size_t>(names.size() - start, BAT_BATCH);
+
+            char bufs[BAT_BATCH][UEVENT_BUF];
+            string paths[BAT_BATCH];
+            Reader::File files[BAT_BATCH];
+            for (size_t i = 0; i < batch; ++i) {
+                paths[i] = SUPPLY_DIR + names[start + i] + "/uevent";
+                files[i] = {paths[i].c_str(), bufs[i], UEVENT_BUF, {}};
+            }
+            Reader::read(files, batch);
+
+            for (size_t i = 0; i < batch; ++i) {
+                const std::string_view uevent = files[i].text;
+                if (uevent.empty()) {
+                    missing = true;
+                    continue;
+                }
+
+                // A removable battery that was taken out of its bay is still a battery
+                if (Reader::value(uevent, "POWER_SUPPLY_PRESENT=") == "0") { continue; }
+
+                const auto e_now = Reader::number(uevent, "POWER_SUPPLY_ENERGY_NOW=");
+                const auto e_full = Reader::number(uevent, "POWER_SUPPLY_ENERGY_FULL=");
+                const auto c_now = Reader::number(uevent, "POWER_SUPPLY_CHARGE_NOW=");
+                const auto c_full = Reader::number(uevent, "POWER_SUPPLY_CHARGE_FULL=");
+                const auto cap = Reader::number(uevent, "POWER_SUPPLY_CAPACITY=");
+                if (!cap && !(e_now && e_full) && !(c_now && c_full)) { continue; }
+
+                energy = energy && e_now && e_full;
+                charge = charge && c_now && c_full;
+                capacities = capacities && cap;
+                energy_now += e_now.value_or(0);
+                energy_full += e_full.value_or(0);
+                charge_now += c_now.value_or(0);
+                charge_full += c_full.value_or(0);
+                capacity += cap.value_or(0);
+
+                const std::string_view status = Reader::value(uevent, "POWER_SUPPLY_STATUS=");
+                charging = charging || status == "Charging";
+                full = full && status == "Full";
+                ++count;
+            }
+        }
+
+        // A battery went away, so the ones we know of may be out of date. Look for them again, once.
+        if (missing && !rescan) { continue; }
+        if (count == 0) { return {}; }
+
+        Battery battery;
+        battery.charging = charging || full;
+
+        // A single battery is shown just like the rest of the system shows it. Capacities are only averaged if there
+        // is no other way of combining batteries, as that would count a small battery as much as a big one.
+        if (capacities && (count == 1 || (!energy && !charge))) { battery.level = static_cast<int>(capacity / count); }
+        else if (energy && energy_full > 0) { battery.level = static_cast<int>(100 * energy_now / energy_full); }
+        else if (charge && charge_full > 0) { battery.level = static_cast<int>(100 * charge_now / charge_full); }
+        else { battery.level = static_cast<int>(capacity / count); }
+        battery.level = std::min(battery.level, 100);
+
+        return battery;
+    }
+
+    return {};
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <optional>
+
+/**
+ * The charge left across every battery in the system. Each battery is read with a single read of its uevent file.
+ *
+ * Which supplies are batteries is only looked up once per boot, and kept in a runtime file so every prompt doesn't
+ * have to walk /sys/class/power_supply. The batteries are looked up again if one of them goes away, but a battery
+ * that is added after it was looked up is only noticed after a reboot.
+ */
+class Battery {
+public:
+    int level = 0; // Charge left across every battery, in percent
+    bool charging = false; // Whether any battery is charging, or all of them are full
+
+    /**
+     * Read the state of every battery
+     * @return The combined state, or nothing if there are no batteries
+     */
+    static std::optional<Battery> collect();
+};
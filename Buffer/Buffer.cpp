@@ -0,0 +1,56 @@
+#include "Buffer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+Buffer *Buffer::add(const std::string_view str) {
+    const size_t size = std::min(str.size(), sizeof buf - len);
+    memcpy(buf + len, str.data(), size);
+    len += size;
+
+    return this;
+}
+
+Buffer *Buffer::add(const char chr) { return add({&chr, 1}); }
+
+Buffer *Buffer::repeat(const std::string_view str, size_t count) {
+    while (count-- > 0 && len + str.size() <= sizeof buf) {
+        memcpy(buf + len, str.data(), str.size());
+        len += str.size();
+    }
+
+    return this;
+}
+
+bool Buffer::read(const int fd) {
+    while (true) {
+        if (len == sizeof buf) { return false; }
+
+        const ssize_t got = ::read(fd, buf + len, sizeof buf - len);
+        if (got == 0) { return true; }
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        len += got;
+    }
+}
+
+bool Buffer::write(const int fd) const {
+    const char *data = buf;
+    size_t size = len;
+
+    while (size > 0) {
+        const ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+
+    return true;
+}
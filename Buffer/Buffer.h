@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string_view>
+
+#include "../config.h"
+
+/**
+ * A fixed-size output buffer. A prompt is rendered straight into one of these, and then sent out with a single write.
+ * Nothing in here allocates, so a buffer can be reused for every prompt. Anything that doesn't fit is dropped.
+ */
+class Buffer {
+    char buf[OUT_BUF_SIZE];
+    size_t len = 0;
+
+public:
+    Buffer *add(std::string_view str);
+
+    Buffer *add(char chr);
+
+    /**
+     * Add a string count times
+     */
+    Buffer *repeat(std::string_view str, size_t count);
+
+    /**
+     * Read from a fd until EOF, adding everything that was read
+     * @param fd fd to read from
+     * @return false if there was an error, or the buffer filled up before EOF
+     */
+    bool read(int fd);
+
+    /**
+     * Write the whole buffer to a fd. Normally this is a single write(), it only takes more on a short write.
+     * @param fd fd to write to
+     * @return true if everything was written
+     */
+    bool write(int fd) const;
+
+    void clear() { len = 0; }
+
+    /**
+     * Drop everything past size
+     */
+    void truncate(const size_t size) { if (size < len) { len = size; } }
+
+    /**
+     * Make room for count more bytes at the end, for the caller to fill in
+     * @return false if they don't fit, in which case nothing changes
+     */
+    bool grow(const size_t count) {
+        if (count > sizeof buf - len) { return false; }
+        len += count;
+        return true;
+    }
+
+    [[nodiscard]] char *data() { return buf; }
+    [[nodiscard]] const char *data() const { return buf; }
+    [[nodiscard]] size_t size() const { return len; }
+    [[nodiscard]] bool empty() const { return len == 0; }
+};
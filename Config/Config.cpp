@@ -0,0 +1,401 @@
+#include "Config.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../config.h"
+#include "../term.h"
+#include "../Reader/Reader.h"
+#include "../Runtime/Runtime.h"
+#include "../Width/Width.h"
+
+using std::string;
+
+// Identifies a compiled config in the current layout. Change this whenever Image or Text changes.
+#define CONFIG_MAGIC 0x63666733
+// Largest config file that is read. Anything past this is ignored.
+#define CONFIG_BUF (16 * 1024)
+
+// Names of the segments in the config file, in the order of Config::Segment
+static constexpr std::string_view segment_names[] = {
+    "status", "user_host", "time", "cpu", "mem", "bat", "python", "git"
+};
+static_assert(std::size(segment_names) == Config::SEGMENT_COUNT);
+
+// Which segments to keep when the terminal is too narrow for all of them, most important first. Segments that a
+// priority setting leaves out keep their place in this order, after the ones it lists.
+static constexpr Config::Segment default_priority[] = {
+    Config::STATUS, Config::GIT, Config::PYTHON, Config::BAT, Config::USER_HOST, Config::CPU, Config::MEM, Config::TIME
+};
+static_assert(std::size(default_priority) == Config::SEGMENT_COUNT);
+
+// Names of the ways to draw the fill in the config file, in the order of Config::Fill
+static constexpr std::string_view fill_names[] = {"chars", "repeat", "move"};
+
+// The settings that are a color, an icon or a separator
+enum class Kind { COLOR, ICON, SEP, FILL };
+struct TextKey {
+    std::string_view key;
+    Config::Text Config::Image::*field;
+    Kind kind;
+};
+static constexpr TextKey text_keys[] = {
+    {"color_ok", &Config::Image::ok, Kind::COLOR},
+    {"color_warn", &Config::Image::warn, Kind::COLOR},
+    {"color_error", &Config::Image::error, Kind::COLOR},
+    {"color_info", &Config::Image::info, Kind::COLOR},
+    {"icon_cpu", &Config::Image::cpu, Kind::ICON},
+    {"icon_mem", &Config::Image::mem, Kind::ICON},
+    {"icon_python", &Config::Image::python, Kind::ICON},
+    {"icon_branch", &Config::Image::branch, Kind::ICON},
+    {"icon_home", &Config::Image::home, Kind::ICON},
+    {"icon_folder", &Config::Image::folder, Kind::ICON},
+    {"icon_lock", &Config::Image::lock, Kind::ICON},
+    {"icon_pending", &Config::Image::pending, Kind::ICON},
+    {"icon_prompt", &Config::Image::prompt, Kind::ICON},
+    {"sep_left", &Config::Image::left_sep, Kind::SEP},
+    {"sep_right", &Config::Image::right_sep, Kind::SEP},
+    {"sep_fill", &Config::Image::fill, Kind::FILL},
+};
+
+// The settings that are a percentage
+struct NumberKey {
+    std::string_view key;
+    int32_t Config::Image::*field;
+};
+static constexpr NumberKey number_keys[] = {
+    {"bat_alarm", &Config::Image::bat_alarm},
+    {"bat_warn", &Config::Image::bat_warn},
+    {"bat_normal", &Config::Image::bat_normal},
+    {"cpu_hot", &Config::Image::cpu_hot},
+};
+
+// The settings in use. Images are never freed or unmapped, as collectors may still be using an older one.
+static std::atomic<const Config::Image*> current = nullptr;
+
+/**
+ * Set a text, along with its display width
+ * @return false if the text doesn't fit
+ */
+static bool setText(Config::Text &text, const std::string_view value) {
+    if (value.size() > sizeof text.data) { return false; }
+
+    memcpy(text.data, value.data(), value.size());
+    text.size = static_cast<uint8_t>(value.size());
+    text.width = static_cast<uint8_t>(std::min<size_t>(Width::of(value), UINT8_MAX));
+    return true;
+}
+
+/**
+ * Get the settings used when there is no config file
+ */
+static const Config::Image &defaults() {
+    static const Config::Image image = [] {
+        Config::Image result {};
+        result.magic = CONFIG_MAGIC;
+        result.size = sizeof result;
+
+        for (uint8_t segment = 0; segment < Config::SEGMENT_COUNT; ++segment) { result.right[segment] = segment; }
+        result.right_count = Config::SEGMENT_COUNT;
+        std::ranges::copy(default_priority, result.priority);
+        result.fill_mode = Config::FILL_CHARS;
+
+        result.bat_alarm = BAT_ALARM;
+        result.bat_warn = BAT_WARN;
+        result.bat_normal = BAT_NORMAL;
+        result.cpu_hot = CPU_HOT;
+        snprintf(result.time_format, sizeof result.time_format, "%s", TIME_FORMAT);
+
+        setText(result.ok, fore::GREEN);
+        setText(result.warn, fore::YELLOW);
+        setText(result.error, fore::RED);
+        setText(result.info, fore::LIGHT_BLUE);
+
+        setText(result.cpu, chars::CPU);
+        setText(result.mem, chars::MEM);
+        setText(result.python, chars::PYTHON);
+        setText(result.branch, chars::BRANCH);
+        setText(result.home, chars::HOME);
+        setText(result.folder, chars::FOLDER);
+        setText(result.lock, chars::LOCK);
+        setText(result.pending, chars::PENDING);
+        setText(result.prompt, "❯");
+
+        setText(result.left_sep, fore::DEFAULT + " " + chars::L_SEP + " ");
+        setText(result.right_sep, fore::DEFAULT + " " + chars::R_SEP + " ");
+        setText(result.fill, chars::M_SEP);
+
+        return result;
+    }();
+
+    return image;
+}
+
+/**
+ * Strip the spaces and tabs from both ends of a string
+ */
+static std::string_view trim(std::string_view str) {
+    const size_t start = str.find_first_not_of(" \t");
+    if (start == std::string_view::npos) { return {}; }
+    const size_t end = str.find_last_not_of(" \t");
+    return str.substr(start, end - start + 1);
+}
+
+/**
+ * Parse a number from 0 to max
+ * @return The number, or -1 if value isn't one
+ */
+static int parseNumber(const std::string_view value, const int max) {
+    int result = -1;
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (error != std::errc{} || end != value.data() + value.size() || result > max) { return -1; }
+    return result;
+}
+
+/**
+ * Parse a list of segment names
+ * @param value The names, separated by spaces
+ * @param out Filled with the segments, in order. Left alone if the list isn't valid.
+ * @param count Set to how many segments are in out
+ * @return What is wrong with the list, or nullptr if it was parsed
+ */
+static const char *parseSegments(std::string_view value, uint8_t *out, uint8_t &count) {
+    uint8_t segments[Config::SEGMENT_COUNT];
+    uint8_t found_count = 0;
+
+    while (!(value = trim(value)).empty()) {
+        const std::string_view name = value.substr(0, value.find_first_of(" \t"));
+        value.remove_prefix(name.size());
+
+        const auto *found = std::ranges::find(segment_names, name);
+        if (found == std::end(segment_names)) { return "unknown segment"; }
+        const auto segment = static_cast<uint8_t>(found - std::begin(segment_names));
+        if (std::find(segments, segments + found_count, segment) != segments + found_count) {
+            return "segment listed twice";
+        }
+        segments[found_count++] = segment;
+    }
+
+    memcpy(out, segments, found_count);
+    count = found_count;
+    return nullptr;
+}
+
+/**
+ * Apply a single setting
+ * @param image Settings to change
+ * @param key Name of the setting
+ * @param value Value of the setting, without quotes
+ * @return What is wrong with the setting, or nullptr if it was applied
+ */
+static const char *apply(Config::Image &image, const std::string_view key, std::string_view value) {
+    if (key == "right") { return parseSegments(value, image.right, image.right_count); }
+
+    if (key == "priority") {
+        uint8_t count;
+        if (const char *error = parseSegments(value, image.priority, count)) { return error; }
+        for (const Config::Segment segment : default_priority) {
+            if (std::find(image.priority, image.priority + count, segment) == image.priority + count) {
+                image.priority[count++] = segment;
+            }
+        }
+        return nullptr;
+    }
+
+    if (key == "fill") {
+        const auto *found = std::ranges::find(fill_names, value);
+        if (found == std::end(fill_names)) { return "expected chars, repeat or move"; }
+        image.fill_mode = static_cast<uint8_t>(found - std::begin(fill_names));
+        return nullptr;
+    }
+
+    if (key == "time_format") {
+        if (value.size() >= sizeof image.time_format) { return "time format too long"; }
+        memcpy(image.time_format, value.data(), value.size());
+        image.time_format[value.size()] = '\0';
+        return nullptr;
+    }
+
+    for (const auto &[name, field] : number_keys) {
+        if (key != name) { continue; }
+        const int number = parseNumber(value, 100);
+        if (number == -1) { return "expected a percentage"; }
+        image.*field = number;
+        return nullptr;
+    }
+
+    for (const auto &[name, field, kind] : text_keys) {
+        if (key != name) { continue; }
+        Config::Text &text = image.*field;
+
+        if (kind == Kind::COLOR) {
+            // A color from the 256 color palette
+            const int color = parseNumber(value, 255);
+            if (color == -1) { return "expected a color from 0 to 255"; }
+            char sequence[16];
+            const int size = snprintf(sequence, sizeof sequence, "\033[38;5;%dm", color);
+            setText(text, {sequence, static_cast<size_t>(size)});
+            return nullptr;
+        }
+
+        if (kind == Kind::SEP) {
+            // Separators are colored and padded just like the default ones
+            const string sep = string{fore::DEFAULT} + " " + string{value} + " ";
+            return setText(text, sep) ? nullptr : "too long";
+        }
+
+        if (kind == Kind::FILL && Width::of(value) != 1) { return "the fill must be one column wide"; }
+        return setText(text, value) ? nullptr : "too long";
+    }
+
+    return "unknown setting";
+}
+
+/**
+ * Compile a config file. Settings that can't be applied are reported, and left at their defaults.
+ * @param source Path of the config file
+ * @param info The config file's stat data, kept in the image to tell when it changes
+ * @return The compiled settings
+ */
+static Config::Image compile(const string &source, const struct stat &info) {
+    Config::Image image = defaults();
+    image.dev = info.st_dev;
+    image.ino = info.st_ino;
+    image.file_size = info.st_size;
+    image.mtime_sec = info.st_mtim.tv_sec;
+    image.mtime_nsec = info.st_mtim.tv_nsec;
+
+    char buf[CONFIG_BUF];
+    std::string_view text = Reader::read(open(source.c_str(), O_RDONLY | O_CLOEXEC), buf, sizeof buf);
+
+    for (size_t number = 1; !text.empty(); ++number) {
+        const std::string_view line = trim(Reader::line(text));
+        if (line.empty() || line.starts_with('#')) { continue; }
+
+        const size_t equals = line.find('=');
+        if (equals == std::string_view::npos) {
+            fprintf(stderr, "promptly: %s:%zu: expected \"key = value\"\n", source.c_str(), number);
+            continue;
+        }
+
+        const std::string_view key = trim(line.substr(0, equals));
+        std::string_view value = trim(line.substr(equals + 1));
+        // Quotes keep any spaces at either end of a value
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+            value = value.substr(1, value.size() - 2);
+        }
+
+        if (const char *error = apply(image, key, value)) {
+            fprintf(stderr, "promptly: %s:%zu: %.*s: %s\n", source.c_str(), number, static_cast<int>(key.size()),
+                    key.data(), error);
+        }
+    }
+
+    return image;
+}
+
+/**
+ * Check whether an image was compiled from the config file as it is now
+ */
+static bool matches(const Config::Image &image, const struct stat &info) {
+    return image.dev == info.st_dev && image.ino == info.st_ino && image.file_size == info.st_size
+           && image.mtime_sec == info.st_mtim.tv_sec && image.mtime_nsec == info.st_mtim.tv_nsec;
+}
+
+/**
+ * Map the compiled config from the runtime dir
+ * @param info The config file's stat data
+ * @return The image, or nullptr if there is none, or it wasn't compiled from the config file as it is now
+ */
+static const Config::Image *map(const struct stat &info) {
+    const int fd = Runtime::open(CONFIG_CACHE_NAME, O_RDONLY);
+    if (fd == -1) { return nullptr; }
+
+    // A file that is too short would fault once it is read
+    struct stat cache {};
+    if (fstat(fd, &cache) != 0 || cache.st_size != sizeof(Config::Image)) {
+        close(fd);
+        return nullptr;
+    }
+
+    void *page = mmap(nullptr, sizeof(Config::Image), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (page == MAP_FAILED) { return nullptr; }
+
+    const auto *image = static_cast<const Config::Image*>(page);
+    if (image->magic != CONFIG_MAGIC || image->size != sizeof(Config::Image) || !matches(*image, info)) {
+        munmap(page, sizeof(Config::Image));
+        return nullptr;
+    }
+
+    return image;
+}
+
+/**
+ * Save a compiled config to the runtime dir, for the prompts after this one
+ * @param image The compiled config
+ */
+static void save(const Config::Image &image) {
+    // Write to a temporary file first, so nobody maps half of an image. A file that is mapped is never changed.
+    const string temp = CONFIG_CACHE_NAME "." + std::to_string(getpid());
+
+    const int fd = Runtime::open(temp, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd == -1) { return; }
+    const bool ok = write(fd, &image, sizeof image) == static_cast<ssize_t>(sizeof image);
+    close(fd);
+
+    const string temp_path = Runtime::path(temp);
+    if (!ok || rename(temp_path.c_str(), Runtime::path(CONFIG_CACHE_NAME).c_str()) != 0) { unlink(temp_path.c_str()); }
+}
+
+/**
+ * Get the path of the config file
+ */
+static const string &sourcePath() {
+    static const string path = [] {
+        if (const char *dir = getenv("XDG_CONFIG_HOME"); dir != nullptr && *dir != '\0') {
+            return string{dir} + "/" CONFIG_PATH;
+        }
+        const char *home = getenv("HOME");
+        return string{home == nullptr ? "" : home} + "/.config/" CONFIG_PATH;
+    }();
+
+    return path;
+}
+
+const Config::Image &Config::load() {
+    const Image *image = current.load(std::memory_order_acquire);
+
+    struct stat info {};
+    if (stat(sourcePath().c_str(), &info) != 0) {
+        // Without a config file, everything is left at its default
+        image = &defaults();
+    } else if (image == nullptr || !matches(*image, info)) {
+        image = map(info);
+
+        if (image == nullptr) {
+            // Kept for the life of the process, just like a mapped image
+            auto *compiled = new Image(compile(sourcePath(), info));
+            save(*compiled);
+            image = compiled;
+        }
+    }
+
+    current.store(image, std::memory_order_release);
+    return *image;
+}
+
+const Config::Image &Config::get() {
+    if (const Image *image = current.load(std::memory_order_acquire)) { return *image; }
+    return load();
+}
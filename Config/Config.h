@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Settings that can be changed without a rebuild: which segments are on the right and in what order, the battery and
+ * cpu thresholds, the time format, the colors and the icons. Anything the config file doesn't set keeps its default
+ * from config.h and term.h.
+ *
+ * The config file ($XDG_CONFIG_HOME/promptly/config, or ~/.config/promptly/config) is made up of "key = value" lines:
+ *
+ *     # Leave out the clock, and show git first
+ *     right = status git user_host cpu mem bat python
+ *     # When the terminal is too narrow for all of them, keep the battery over git
+ *     priority = status bat git
+ *     bat_warn = 20
+ *     fill = repeat
+ *     color_warn = 214
+ *     icon_prompt = "$"
+ *
+ * It is only parsed when it changes. It is compiled into a flat image, which is kept in the runtime dir along with the
+ * mtime of the file it was compiled from, so all a prompt has to do is stat the config file and map the image.
+ */
+class Config {
+public:
+    /**
+     * A color, icon or separator, along with its display width
+     */
+    struct Text {
+        uint8_t size;
+        uint8_t width;
+        char data[62];
+
+        // ReSharper disable once CppNonExplicitConversionOperator
+        operator std::string_view() const { return {data, size}; } // NOLINT(*-explicit-constructor)
+    };
+
+    enum Segment : uint8_t { STATUS, USER_HOST, TIME, CPU, MEM, BAT, PYTHON, GIT, SEGMENT_COUNT };
+
+    /**
+     * How the gap between the left and the right segments is drawn
+     */
+    enum Fill : uint8_t {
+        FILL_CHARS,  // The fill, repeated across the whole gap. Works on every terminal.
+        FILL_REPEAT, // The fill once, then repeated by the terminal with REP. Needs a terminal that supports REP.
+        FILL_MOVE,   // No fill, the cursor is moved to where the right segments start with CHA
+    };
+
+    /**
+     * Every setting, laid out flat so it can be mapped straight from the compiled file
+     */
+    struct Image {
+        uint32_t magic;
+        uint32_t size; // sizeof(Image) in the version that compiled it
+
+        // Identifies the config file the image was compiled from. All zero for the defaults.
+        uint64_t dev;
+        uint64_t ino;
+        int64_t file_size;
+        int64_t mtime_sec;
+        int64_t mtime_nsec;
+
+        uint8_t right[SEGMENT_COUNT]; // Segments shown on the right, in order
+        uint8_t right_count;
+        uint8_t priority[SEGMENT_COUNT]; // Every segment, the one to keep longest on a narrow terminal first
+        uint8_t fill_mode; // A Fill
+
+        int32_t bat_alarm;
+        int32_t bat_warn;
+        int32_t bat_normal;
+        int32_t cpu_hot;
+        char time_format[32];
+
+        // Colors: ok for a clean or healthy state, warn and error for the two levels of trouble, info for the rest
+        Text ok, warn, error, info;
+        // Icons
+        Text cpu, mem, python, branch, home, folder, lock, pending, prompt;
+        // The left and right separators include their color and the padding around them. The fill is always one
+        // column wide.
+        Text left_sep, right_sep, fill;
+    };
+
+    /**
+     * Check whether the config file changed, and if it did, compile it again and switch to it. Settings that were
+     * handed out before keep working, as an image is never unmapped.
+     * @return The current settings
+     */
+    static const Image &load();
+
+    /**
+     * Get the settings found by the last load(), without checking the config file. Loads them if they were never
+     * loaded.
+     * @return The current settings
+     */
+    static const Image &get();
+};
@@ -0,0 +1,124 @@
+#include "Context.h"
+
+#include <cstdlib>
+#include <pwd.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+// Number of fixed fields in a serialized context, before the exit codes
+#define FIELD_COUNT 10
+
+/**
+ * Get the homedir of the user. Uses $HOME, and falls back on looking the user up in
+ * the password database if $HOME is unset.
+ * @return A string representing the current user's homedir
+ */
+static string getHome() {
+    const char* buf = std::getenv("HOME");
+    // If HOME is unset, fall back on our homedir in the password database
+    if (buf == nullptr) { buf = getpwuid(getuid())->pw_dir; }
+
+    // Convert from char* to string
+    string home(buf);
+    // If home has a trailing /, remove it
+    if (home.ends_with('/')) { home.erase(home.size() - 1); }
+
+    return home;
+}
+
+static size_t getSize() {
+    winsize size {};
+    ioctl(STDERR_FILENO, TIOCGWINSZ, &size);
+    return size.ws_col;
+}
+
+/**
+ * Get an environment variable, treating an unset variable as an empty string
+ * @param name Name of the variable
+ * @return The value of the variable, or an empty string if it is unset
+ */
+static string getEnv(const char *name) {
+    const char *val = std::getenv(name);
+    return val == nullptr ? string{} : string{val};
+}
+
+Context Context::fromEnv(const int argc, char **argv) {
+    Context ctx;
+
+    ctx.width = getSize();
+    ctx.sid = getsid(0);
+
+    // utmp stores the tty w/o /dev (e.g. pts/1 instead of /dev/pts/1), so we do the same
+    if (const char *tty = ttyname(STDIN_FILENO); tty != nullptr) {
+        ctx.tty = tty;
+        if (ctx.tty.starts_with("/dev/")) { ctx.tty.erase(0, sizeof "/dev/" - 1); }
+    }
+
+    char *pwd = get_current_dir_name();
+    if (pwd != nullptr) {
+        ctx.pwd = pwd;
+        free(pwd);
+    }
+
+    ctx.home = getHome();
+    ctx.venv_prompt = getEnv("VIRTUAL_ENV_PROMPT");
+    ctx.venv = getEnv("VIRTUAL_ENV");
+    ctx.ssh = std::getenv("SSH_CONNECTION") != nullptr;
+
+    // Set by the shell snippets, for prompts that go into $PROMPT or $PS1
+    const string shell = getEnv("PROMPTLY_SHELL");
+    if (shell == "zsh") { ctx.shell = Shell::Zsh; }
+    else if (shell == "bash") { ctx.shell = Shell::Bash; }
+
+    for (int arg = 1; arg < argc; arg++) { ctx.status.emplace_back(argv[arg]); }
+
+    return ctx;
+}
+
+string Context::serialize() const {
+    string data;
+
+    for (const string &field : {
+             std::to_string(width), std::to_string(sid), tty, pwd, home, venv_prompt, venv, string{ssh ? "1" : "0"},
+             string{static_cast<char>(phase)}, string{static_cast<char>(shell)}
+         }) {
+        data += field;
+        data += '\0';
+    }
+
+    for (const string &code : status) {
+        data += code;
+        data += '\0';
+    }
+
+    return data;
+}
+
+bool Context::deserialize(const string &data, Context &ctx) {
+    std::vector<string> fields;
+
+    for (size_t head = 0, i = 0; i < data.size(); ++i) {
+        if (data[i] == '\0') {
+            fields.emplace_back(data, head, i - head);
+            head = i + 1;
+        }
+    }
+
+    if (fields.size() < FIELD_COUNT) { return false; }
+
+    ctx.width = std::strtoul(fields[0].c_str(), nullptr, 10);
+    ctx.sid = std::strtol(fields[1].c_str(), nullptr, 10);
+    ctx.tty = std::move(fields[2]);
+    ctx.pwd = std::move(fields[3]);
+    ctx.home = std::move(fields[4]);
+    ctx.venv_prompt = std::move(fields[5]);
+    ctx.venv = std::move(fields[6]);
+    ctx.ssh = fields[7] == "1";
+    if (fields[8] == "f") { ctx.phase = Phase::First; }
+    else if (fields[8] == "r") { ctx.phase = Phase::Refresh; }
+    if (fields[9] == "z") { ctx.shell = Shell::Zsh; }
+    else if (fields[9] == "b") { ctx.shell = Shell::Bash; }
+    ctx.status.assign(fields.begin() + FIELD_COUNT, fields.end());
+
+    return true;
+}
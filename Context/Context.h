@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+using std::string;
+
+/**
+ * Everything a prompt render needs to know about the shell that asked for it. When rendering locally this is filled
+ * from our own environment, when rendering in the daemon it is sent over by the client.
+ */
+struct Context {
+    /**
+     * How long a render waits on the collectors that can be slow (see Prompt::render)
+     */
+    enum class Phase : char {
+        Blocking = 'b', // As long as any other collector
+        First = 'f',    // Not at all, their last known values are used. A refresh is meant to follow.
+        Refresh = 'r',  // Up to ASYNC_TIMEOUT
+    };
+
+    /**
+     * The shell the prompt is shown by, which decides how it is quoted (see $PROMPTLY_SHELL)
+     */
+    enum class Shell : char {
+        Other = 'o', // Printed as it is
+        Zsh = 'z',
+        Bash = 'b',
+    };
+
+    size_t width = 0;       // Width of the terminal, in columns. 0 if unknown.
+    long sid = 0;           // Session id of the shell
+    string tty;             // tty of the shell, without the leading /dev/ (e.g. pts/1)
+    string pwd;             // Current working directory
+    string home;            // Homedir of the user, without a trailing /
+    string venv_prompt;     // $VIRTUAL_ENV_PROMPT
+    string venv;            // $VIRTUAL_ENV
+    bool ssh = false;       // Whether $SSH_CONNECTION is set
+    Phase phase = Phase::Blocking;
+    Shell shell = Shell::Other;
+    std::vector<string> status; // Exit codes of the last command
+
+    /**
+     * Build a context from the environment of the current process
+     * @param argc Argument count, as passed to main
+     * @param argv Arguments, as passed to main. Every argument is treated as an exit code.
+     * @return The filled context
+     */
+    static Context fromEnv(int argc, char **argv);
+
+    /**
+     * Serialize the context into a buffer that can be sent to the daemon. Fields are separated by NUL bytes.
+     * @return The serialized context
+     */
+    [[nodiscard]] string serialize() const;
+
+    /**
+     * Rebuild a context from the output of serialize()
+     * @param data Serialized context
+     * @param ctx Context to fill
+     * @return true if data contained a complete context, false otherwise
+     */
+    static bool deserialize(const string &data, Context &ctx);
+};
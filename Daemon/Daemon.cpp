@@ -0,0 +1,198 @@
+#include "Daemon.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "../config.h"
+#include "../Buffer/Buffer.h"
+#include "../Prompt/Prompt.h"
+#include "../Runtime/Runtime.h"
+#include "../Sampler/Sampler.h"
+
+// Largest request we will accept from a client. A context is a handful of paths and exit codes,
+// so anything larger than this is not a real client.
+#define MAX_REQUEST (64 * 1024)
+// Sent ahead of a prompt, telling the client whether rendering it again later would show anything new
+#define COMPLETE 'c'
+#define PARTIAL 'p'
+
+string Daemon::sockPath() { return Runtime::path(SOCK_NAME); }
+
+/**
+ * Fill a sockaddr_un with the socket path
+ * @param path Path of the socket
+ * @param addr Address to fill
+ * @return false if there is no path (the runtime dir isn't safe to use), or it is too long to fit in a sockaddr_un
+ */
+static bool fillAddr(const string &path, sockaddr_un &addr) {
+    addr = {};
+    addr.sun_family = AF_UNIX;
+    // An empty path would bind to an address in the abstract namespace instead, which anyone can connect to
+    if (path.empty() || path.size() >= sizeof addr.sun_path) { return false; }
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+/**
+ * Read from a fd until EOF
+ * @param fd fd to read from
+ * @param out Filled with everything that was read
+ * @param max Stop and fail if more than max bytes are read
+ * @return true if EOF was reached without errors
+ */
+static bool readAll(const int fd, string &out, const size_t max) {
+    char buf[4096];
+
+    while (true) {
+        const ssize_t got = read(fd, buf, sizeof buf);
+        if (got == 0) return true;
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (out.size() + got > max) return false;
+        out.append(buf, got);
+    }
+}
+
+/**
+ * Check that the other end of a connected socket is a process of our own user
+ * @param sock The connected socket
+ */
+static bool ours(const int sock) {
+    ucred cred {};
+    socklen_t cred_len = sizeof cred;
+    return getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) == 0 && cred.uid == getuid();
+}
+
+/**
+ * Handle a single client: read its context, render the prompt and send it back. The prompt is preceded by a single
+ * byte: COMPLETE if it is complete, or PARTIAL if a slow collector didn't make it.
+ * @param client fd of the connected client
+ */
+static void handle(const int client) {
+    // Only render prompts for our own user. The socket is only reachable by us anyways, unless
+    // $XDG_RUNTIME_DIR points somewhere it shouldn't.
+    if (!ours(client)) { return; }
+
+    string request;
+    Context ctx;
+    if (!readAll(client, request, MAX_REQUEST) || !Context::deserialize(request, ctx)) { return; }
+
+    // Clients are handled one at a time, so a client can't hold up everyone else by asking us to wait on slow
+    // collectors. A refresher asks again instead (see Async::refresh).
+    if (ctx.phase == Context::Phase::Refresh) { ctx.phase = Context::Phase::Blocking; }
+
+    // Clients are handled one at a time, so they can all share one buffer
+    static Buffer out;
+    out.clear();
+
+    // If rendering fails, close the connection without an answer - the client will render the prompt itself
+    try {
+        const char status = Prompt::render(ctx, out) ? COMPLETE : PARTIAL;
+        if (write(client, &status, 1) == 1) { out.write(client); }
+    } catch (const std::exception &e) {
+        fprintf(stderr, "promptly: failed to render prompt: %s\n", e.what());
+    }
+}
+
+int Daemon::serve() {
+    const string path = sockPath();
+    sockaddr_un addr;
+    if (!fillAddr(path, addr)) {
+        fprintf(stderr, "promptly: socket path too long: %s\n", path.c_str());
+        return 1;
+    }
+
+    // A client hanging up early must not kill us
+    signal(SIGPIPE, SIG_IGN);
+
+    const int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock == -1) {
+        perror("promptly: socket");
+        return 1;
+    }
+
+    // Make sure the socket is only accessible by us
+    umask(0077);
+
+    if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0) {
+        // If the socket already exists, it is either in use by another daemon, or left behind by a dead one
+        const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const bool running = connect(probe, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0;
+        close(probe);
+
+        if (running) {
+            fprintf(stderr, "promptly: daemon already running on %s\n", path.c_str());
+            return 1;
+        }
+
+        unlink(path.c_str());
+        if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0) {
+            perror("promptly: bind");
+            return 1;
+        }
+    }
+
+    if (listen(sock, SOMAXCONN) != 0) {
+        perror("promptly: listen");
+        return 1;
+    }
+
+    // Keep the cpu samples fresh for as long as we are running
+    Sampler::start();
+
+    while (true) {
+        const int client = accept4(sock, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("promptly: accept");
+            return 1;
+        }
+
+        // Don't let a client that never finishes its request block everyone else
+        constexpr timeval timeout {.tv_sec = 0, .tv_usec = SOCK_TIMEOUT * 1000};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+
+        handle(client);
+        close(client);
+    }
+}
+
+bool Daemon::request(const Context &ctx, Buffer &out, bool &complete) {
+    sockaddr_un addr;
+    if (!fillAddr(sockPath(), addr)) { return false; }
+
+    const int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock == -1) { return false; }
+
+    // If the daemon is stuck, give up quickly and let the caller render the prompt itself
+    constexpr timeval timeout {.tv_sec = 0, .tv_usec = SOCK_TIMEOUT * 1000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+
+    const string data = ctx.serialize();
+
+    // Use send() with MSG_NOSIGNAL, so a daemon going away mid-request doesn't kill us with SIGPIPE. Whoever is
+    // listening has to be our own user, or it would be shown our context and could answer with any prompt it likes.
+    char status = 0;
+    const bool ok = connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0
+                    && ours(sock)
+                    && send(sock, data.data(), data.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(data.size())
+                    && shutdown(sock, SHUT_WR) == 0
+                    && recv(sock, &status, 1, 0) == 1
+                    && out.read(sock);
+
+    close(sock);
+
+    complete = status == COMPLETE;
+    return ok && (status == COMPLETE || status == PARTIAL) && !out.empty();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+#include "../Context/Context.h"
+
+using std::string;
+
+class Buffer;
+
+/**
+ * A long-running prompt server. The daemon listens on a unix socket, and renders a prompt for every client that
+ * connects. Since it never exits, everything the renderer caches stays warm between prompts.
+ */
+class Daemon {
+    static string sockPath();
+public:
+    /**
+     * Listen for clients and render their prompts. Only returns if the socket could not be set up.
+     * @return exit code for the process
+     */
+    static int serve();
+
+    /**
+     * Ask a running daemon to render a prompt
+     * @param ctx The shell to render the prompt for
+     * @param out Buffer to read the rendered prompt into
+     * @param complete Set to whether the prompt is complete, see Prompt::render
+     * @return true if the daemon rendered the prompt, false if there is no daemon or it did not answer in time
+     */
+    static bool request(const Context &ctx, Buffer &out, bool &complete);
+};
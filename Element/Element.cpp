@@ -1,24 +1,24 @@
 #include "Element.h"
 
-#include <cstring>
+#include "../Width/Width.h"
 
-Element::Element(const string &content): content(content), len(content.length()) {}
+Element::Element(const string &content): content(content), len(Width::of(content)) {}
 
-Element *Element::add(const string &str, const size_t size) {
+Element *Element::add(const std::string_view str, const size_t size) {
     content += str;
     len += size;
 
     return this;
 }
 
-Element *Element::add(const string &str) { return add(str, str.length()); }
+Element *Element::add(const std::string_view str) { return add(str, Width::of(str)); }
 
-Element *Element::add(const char chr) { return add({chr}, 1); }
+Element *Element::add(const char chr) { return add({&chr, 1}); }
 
-Element *Element::addForm(const string &str) { return add(str, 0); }
+Element *Element::addForm(const std::string_view str) { return add(str, 0); }
 
-Element * Element::addIcon(const string &str) { return add(str + " ", 2); }
+Element * Element::addIcon(const std::string_view str) { return add(str)->add(' '); }
 
-string Element::getContent() const { return content; }
+const string &Element::getContent() const { return content; }
 
 string::size_type Element::getLen() const { return len; }
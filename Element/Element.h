@@ -1,6 +1,9 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+
+#include "../Literal/Literal.h"
 
 using std::string;
 
@@ -13,16 +16,22 @@ public:
     // ReSharper disable once CppNonExplicitConvertingConstructor
     Element(const string& content); // NOLINT(*-explicit-constructor)
 
-    Element *add(const string &str, size_t size);
+    Element *add(std::string_view str, size_t size);
 
-    Element *add(const string &str);
+    Element *add(std::string_view str);
 
     Element *add(char chr);
 
-    Element *addForm(const string &str);
+    /**
+     * Add a string fixed at compile time, using the width worked out along with it
+     */
+    template <size_t N>
+    Element *add(const Literal<N> &lit) { return add(lit, lit.width); }
+
+    Element *addForm(std::string_view str);
 
-    Element *addIcon(const string &str);
+    Element *addIcon(std::string_view str);
 
-    [[nodiscard]] string getContent() const;
+    [[nodiscard]] const string &getContent() const;
     [[nodiscard]] string::size_type getLen() const;
 };
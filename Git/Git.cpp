@@ -0,0 +1,600 @@
+#include "Git.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../config.h"
+#include "../Hash/Hash.h"
+#include "../Runtime/Runtime.h"
+
+using steady = std::chrono::steady_clock;
+
+// Size of an object hash. Only sha1 repositories are supported, the index of a sha256 repository fails to parse.
+#define GIT_HASH 20
+// Size of an index entry up to its name: ctime, mtime, dev, ino, mode, uid, gid and size, the hash and the flags
+#define ENTRY_FIXED (40 + GIT_HASH + 2)
+// Identifies a cache file in the current layout. Change this whenever Cached or Header changes.
+#define GIT_CACHE_MAGIC 0x67697431
+// How many slots to look at for a repository, starting from the one its git dir hashes to
+#define GIT_CACHE_PROBE 4
+
+// Index entry flags
+#define CE_VALID 0x8000 // Assume unchanged
+#define CE_EXTENDED 0x4000 // Followed by a second set of flags
+#define CE_STAGE 0x3000 // Non-zero for unmerged entries
+// Extended index entry flags
+#define CE_INTENT_TO_ADD 0x2000
+#define CE_SKIP_WORKTREE 0x4000
+
+// Mode of a submodule
+#define S_IFGITLINK 0160000
+
+struct Repo {
+    string worktree;
+    string gitdir;
+};
+
+/**
+ * The index, mapped into memory. Names point into the mapping (or into v4_names for version 4 indexes, where names
+ * are compressed), so they are only valid for as long as the Index is.
+ */
+struct Index {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    std::vector<std::string_view> names; // Every tracked path, sorted
+    std::vector<string> v4_names;
+
+    Index() = default;
+    Index(const Index&) = delete;
+    Index &operator=(const Index&) = delete;
+    ~Index() { if (data != nullptr) munmap(const_cast<uint8_t*>(data), size); }
+};
+
+// Results for a repository, kept for as long as its index stays the same. They are shared between every prompt through
+// a file mapped from the runtime dir, so a check that only finished in one prompt is reused by the next.
+struct Cached {
+    uint64_t gitdir; // Hash of the git dir
+    int64_t mtime_sec; // stat() of the index
+    int64_t mtime_nsec;
+    int64_t size;
+    uint64_t ino;
+    // When the tree was checked, in nanoseconds of the realtime clock, as the monotonic clock starts over on every
+    // boot and the runtime dir in /tmp may not
+    int64_t checked;
+    int64_t reuse; // How long (in nanoseconds) a clean tree and the untracked files are reused for
+    uint8_t dirty;
+    uint8_t untracked;
+    char pad[2];
+    uint32_t check; // Hash of every other field. Lets us spot entries that were torn by two prompts writing at once.
+};
+static_assert(sizeof(Cached) == offsetof(Cached, check) + sizeof(Cached::check), "Cached has padding");
+
+struct Header {
+    uint32_t magic;
+    uint32_t slots;
+};
+
+// A gitignore pattern
+struct Rule {
+    string base; // Directory of the file the pattern is from, relative to the work tree, with a trailing '/'
+    string pattern;
+    bool negate; // Pattern started with '!'
+    bool dir_only; // Pattern ended with '/'
+    bool anchored; // Pattern has a '/' in it, so it matches the whole path instead of just the name
+};
+
+static uint32_t be32(const uint8_t *p) { return p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]; }
+static uint16_t be16(const uint8_t *p) { return p[0] << 8 | p[1]; }
+
+/**
+ * Read a whole file
+ * @param dir_fd Directory to open path relative to
+ * @param path File to read
+ * @return The contents of the file, or an empty string if it could not be read
+ */
+static string readFile(const int dir_fd, const char *path) {
+    const int fd = openat(dir_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) { return {}; }
+
+    string contents;
+    char buf[4096];
+    for (ssize_t got; (got = read(fd, buf, sizeof buf)) > 0; ) { contents.append(buf, got); }
+    close(fd);
+
+    return contents;
+}
+
+/**
+ * Find the repository a directory is in, by looking for a .git in it and every directory above it
+ * @param dir Directory to start looking from
+ * @return The repository, or nothing if dir is not in one
+ */
+static std::optional<Repo> findRepo(const string &dir) {
+    // Every .git that is looked for is built in the same buffer, a directory shorter each time
+    string dotgit;
+    dotgit.reserve(dir.size() + sizeof "//.git");
+
+    std::string_view current = dir;
+    while (true) {
+        dotgit.assign(current);
+        if (!current.ends_with('/')) { dotgit += '/'; }
+        dotgit += ".git";
+
+        struct stat info {};
+        if (stat(dotgit.c_str(), &info) == 0) {
+            if (S_ISDIR(info.st_mode)) { return Repo{string{current}, dotgit}; }
+
+            // Work trees and submodules have a .git file pointing to their git dir instead
+            string link = readFile(AT_FDCWD, dotgit.c_str());
+            if (link.starts_with("gitdir: ")) {
+                link.erase(0, 8);
+                while (link.ends_with('\n') || link.ends_with('\r')) { link.pop_back(); }
+                if (!link.starts_with('/')) { link = string{current} + "/" + link; }
+                return Repo{string{current}, link};
+            }
+        }
+
+        if (current.empty() || current == "/") { return {}; }
+
+        const size_t slash = current.find_last_of('/');
+        current = slash == 0 || slash == string::npos ? "/" : current.substr(0, slash);
+    }
+}
+
+/**
+ * Read the checked out branch from HEAD
+ * @param gitdir The repository's git dir
+ * @return The branch, or the abbreviated commit if HEAD is detached
+ */
+static string readHead(const string &gitdir) {
+    string head = readFile(AT_FDCWD, (gitdir + "/HEAD").c_str());
+    while (head.ends_with('\n') || head.ends_with('\r')) { head.pop_back(); }
+
+    if (head.starts_with("ref: ")) {
+        head.erase(0, 5);
+        if (head.starts_with("refs/heads/")) { head.erase(0, 11); }
+        return head;
+    }
+
+    return head.substr(0, 7);
+}
+
+/**
+ * Check if a file still matches the stat data cached for it in the index
+ * @param entry The file's index entry
+ * @param info The file's stat data
+ */
+static bool statMatches(const uint8_t *entry, const struct stat &info) {
+    const uint32_t mode = be32(entry + 24);
+
+    // Index entries only hold the lower 32 bits of these
+    if (be32(entry + 8) != static_cast<uint32_t>(info.st_mtim.tv_sec)) { return false; }
+    if (be32(entry + 12) != static_cast<uint32_t>(info.st_mtim.tv_nsec)) { return false; }
+    if (be32(entry + 20) != static_cast<uint32_t>(info.st_ino)) { return false; }
+    if (be32(entry + 36) != static_cast<uint32_t>(info.st_size)) { return false; }
+
+    // A file that became a symlink, or the other way around, or lost or gained its executable bit
+    if ((mode & S_IFMT) != (info.st_mode & S_IFMT)) { return false; }
+    if (S_ISREG(info.st_mode) && !(mode & S_IXUSR) != !(info.st_mode & S_IXUSR)) { return false; }
+
+    return true;
+}
+
+/**
+ * Map and parse the index. If check is set, every tracked file is also compared against the stat data in the
+ * index, until one is found that doesn't match.
+ * @param path Path of the index
+ * @param root_fd fd of the work tree
+ * @param check Whether to check for modified files
+ * @param index Filled with the index
+ * @param dirty Set if a modified file was found
+ * @return false if the index exists but could not be read
+ */
+static bool readIndex(const string &path, const int root_fd, const bool check, Index &index, bool &dirty) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    // A new repository has no index until something is added
+    if (fd == -1) { return errno == ENOENT; }
+
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || info.st_size < 12 + GIT_HASH) {
+        close(fd);
+        return false;
+    }
+
+    void *map = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) { return false; }
+
+    index.data = static_cast<const uint8_t*>(map);
+    index.size = info.st_size;
+
+    const uint8_t *data = index.data;
+    if (memcmp(data, "DIRC", 4) != 0) { return false; }
+
+    const uint32_t version = be32(data + 4);
+    const uint32_t count = be32(data + 8);
+    if (version < 2 || version > 4 || count > index.size / ENTRY_FIXED) { return false; }
+
+    index.names.reserve(count);
+    // Names are never moved once they are in v4_names, as it never grows past count
+    if (version == 4) { index.v4_names.reserve(count); }
+
+    // Entries are followed by extensions, and the whole file by its hash
+    const uint8_t *pos = data + 12;
+    const uint8_t *end = data + index.size - GIT_HASH;
+    std::string_view prev;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint8_t *entry = pos;
+        if (end - entry < ENTRY_FIXED) { return false; }
+
+        const uint16_t flags = be16(entry + 40 + GIT_HASH);
+        uint16_t ext = 0;
+
+        const uint8_t *name = entry + ENTRY_FIXED;
+        if (flags & CE_EXTENDED) {
+            if (version < 3 || end - name < 2) { return false; }
+            ext = be16(name);
+            name += 2;
+        }
+
+        std::string_view path_name;
+        if (version == 4) {
+            // The name is the previous one with some bytes dropped from its end, followed by a new suffix
+            size_t strip = *name & 0x7f;
+            while (*name++ & 0x80) {
+                if (name >= end) { return false; }
+                strip = ((strip + 1) << 7) | (*name & 0x7f);
+            }
+            if (strip > prev.size()) { return false; }
+
+            const auto *nul = static_cast<const uint8_t*>(memchr(name, 0, end - name));
+            if (nul == nullptr) { return false; }
+
+            string &full = index.v4_names.emplace_back(prev.substr(0, prev.size() - strip));
+            full.append(reinterpret_cast<const char*>(name), nul - name);
+            path_name = full;
+            pos = nul + 1;
+        } else {
+            const auto *nul = static_cast<const uint8_t*>(memchr(name, 0, end - name));
+            if (nul == nullptr) { return false; }
+
+            path_name = {reinterpret_cast<const char*>(name), static_cast<size_t>(nul - name)};
+            // Entries are padded with NULs to a multiple of 8 bytes
+            pos = entry + ((name - entry + path_name.size() + 8) & ~static_cast<size_t>(7));
+            if (pos > end) { return false; }
+        }
+
+        index.names.push_back(path_name);
+        prev = path_name;
+
+        if (!check || dirty) { continue; }
+
+        // Unmerged and newly added files always count as changes
+        if (flags & CE_STAGE || ext & CE_INTENT_TO_ADD) {
+            dirty = true;
+            continue;
+        }
+
+        // Files git was told not to look at, and submodules
+        if (flags & CE_VALID || ext & CE_SKIP_WORKTREE) { continue; }
+        if ((be32(entry + 24) & S_IFMT) == S_IFGITLINK) { continue; }
+
+        // Names are always followed by a NUL, both in the mapping and in v4_names
+        struct stat file {};
+        if (fstatat(root_fd, path_name.data(), &file, AT_SYMLINK_NOFOLLOW) != 0 || !statMatches(entry, file)) {
+            dirty = true;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Load the patterns in a gitignore file
+ * @param dir_fd Directory to open path relative to
+ * @param path gitignore file to load
+ * @param base Directory the patterns apply to, relative to the work tree, with a trailing '/'
+ * @param rules Patterns are added to this
+ */
+static void loadRules(const int dir_fd, const char *path, const string &base, std::vector<Rule> &rules) {
+    const string contents = readFile(dir_fd, path);
+
+    for (size_t start = 0; start < contents.size(); ) {
+        size_t end = contents.find('\n', start);
+        if (end == string::npos) { end = contents.size(); }
+
+        string line = contents.substr(start, end - start);
+        start = end + 1;
+
+        while (line.ends_with('\r') || (line.ends_with(' ') && !line.ends_with("\\ "))) { line.pop_back(); }
+        if (line.empty() || line.starts_with('#')) { continue; }
+
+        Rule rule {base, {}, false, false, false};
+        if (line.starts_with('!')) {
+            rule.negate = true;
+            line.erase(0, 1);
+        }
+        if (line.ends_with('/')) {
+            rule.dir_only = true;
+            line.pop_back();
+        }
+        // A leading "**/" matches in every directory, same as having no '/' at all
+        while (line.starts_with("**/")) { line.erase(0, 3); }
+
+        rule.anchored = line.find('/') != string::npos;
+        if (line.starts_with('/')) { line.erase(0, 1); }
+        if (line.empty()) { continue; }
+
+        rule.pattern = std::move(line);
+        rules.push_back(std::move(rule));
+    }
+}
+
+/**
+ * Check if a path is ignored. Patterns loaded later take precedence.
+ * @param rules Every pattern that has been loaded
+ * @param path Path relative to the work tree
+ * @param name Last element of path
+ * @param is_dir Whether path is a directory
+ */
+static bool ignored(const std::vector<Rule> &rules, const string &path, const char *name, const bool is_dir) {
+    for (auto rule = rules.rbegin(); rule != rules.rend(); ++rule) {
+        if (rule->dir_only && !is_dir) { continue; }
+        if (!path.starts_with(rule->base)) { continue; }
+
+        const bool match = rule->anchored
+            ? fnmatch(rule->pattern.c_str(), path.c_str() + rule->base.size(), FNM_PATHNAME) == 0
+            : fnmatch(rule->pattern.c_str(), name, 0) == 0;
+
+        if (match) { return !rule->negate; }
+    }
+
+    return false;
+}
+
+/**
+ * Look for a file that is neither tracked nor ignored. Directories are searched breadth first, and the search gives
+ * up after looking at GIT_UNTRACKED_MAX entries.
+ * @param root_fd fd of the work tree
+ * @param gitdir The repository's git dir
+ * @param index The index, to find tracked files in
+ * @return true if an untracked file was found
+ */
+static bool findUntracked(const int root_fd, const string &gitdir, const Index &index) {
+    std::vector<Rule> rules;
+
+    // The user's global ignore file, then the repository's, then every .gitignore as we reach it
+    if (const char *xdg = getenv("XDG_CONFIG_HOME"); xdg != nullptr && *xdg != '\0') {
+        loadRules(AT_FDCWD, (string{xdg} + "/git/ignore").c_str(), "", rules);
+    } else if (const char *home = getenv("HOME"); home != nullptr) {
+        loadRules(AT_FDCWD, (string{home} + "/.config/git/ignore").c_str(), "", rules);
+    }
+    loadRules(AT_FDCWD, (gitdir + "/info/exclude").c_str(), "", rules);
+
+    const auto &names = index.names;
+
+    // Directories to search, relative to the work tree. Each one is either "" or ends in a '/'.
+    std::vector<string> queue {""};
+    size_t budget = GIT_UNTRACKED_MAX;
+
+    for (size_t i = 0; i < queue.size() && budget > 0; ++i) {
+        const string dir = queue[i];
+
+        const int fd = openat(root_fd, dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd == -1) { continue; }
+
+        loadRules(fd, ".gitignore", dir, rules);
+
+        DIR *dp = fdopendir(fd);
+        if (dp == nullptr) {
+            close(fd);
+            continue;
+        }
+
+        bool found = false;
+        for (const dirent *ep; !found && budget > 0 && (ep = readdir(dp)) != nullptr; --budget) {
+            const char *name = ep->d_name;
+            if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0 || strcmp(name, ".git") == 0) { continue; }
+
+            bool is_dir = ep->d_type == DT_DIR;
+            if (ep->d_type == DT_UNKNOWN) {
+                struct stat info {};
+                is_dir = fstatat(fd, name, &info, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(info.st_mode);
+            }
+
+            string path = dir + name;
+            if (ignored(rules, path, name, is_dir)) { continue; }
+
+            // Submodules are tracked as a single entry, and their contents belong to them
+            const bool tracked = std::binary_search(names.begin(), names.end(), std::string_view{path});
+
+            if (is_dir) {
+                if (tracked) { continue; }
+                // Git doesn't track directories, so search every directory that isn't ignored. One with nothing
+                // tracked in it only counts as untracked if there is a file in it that isn't ignored either.
+                queue.push_back(path + "/");
+            } else {
+                found = !tracked;
+            }
+        }
+
+        closedir(dp);
+        if (found) { return true; }
+    }
+
+    return false;
+}
+
+/**
+ * Map the cache of results, creating it if needed. It is mapped once, and kept for the life of the process.
+ * @return The slots of the cache, or nullptr if it could not be mapped
+ */
+static Cached *cacheMap() {
+    static Cached *entries = [] () -> Cached* {
+        constexpr size_t size = sizeof(Header) + sizeof(Cached) * GIT_CACHE_SLOTS;
+
+        const int fd = Runtime::open(GIT_CACHE_NAME, O_RDWR | O_CREAT);
+        if (fd == -1) { return nullptr; }
+
+        struct stat info {};
+        if (fstat(fd, &info) != 0 || (static_cast<size_t>(info.st_size) < size && ftruncate(fd, size) != 0)) {
+            close(fd);
+            return nullptr;
+        }
+
+        void *page = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (page == MAP_FAILED) { return nullptr; }
+
+        // A new file, or one from an older version of the cache - start over
+        auto *header = static_cast<Header*>(page);
+        if (header->magic != GIT_CACHE_MAGIC || header->slots != GIT_CACHE_SLOTS) {
+            memset(page, 0, size);
+            header->slots = GIT_CACHE_SLOTS;
+            header->magic = GIT_CACHE_MAGIC;
+        }
+
+        return reinterpret_cast<Cached*>(header + 1);
+    }();
+
+    return entries;
+}
+
+static uint32_t checksum(const Cached &entry) {
+    const uint64_t hash = fnv(&entry, offsetof(Cached, check));
+    // A zeroed slot must never look valid
+    return static_cast<uint32_t>(hash ^ hash >> 32) | 1;
+}
+
+/**
+ * Look up the results for a repository
+ * @param gitdir Hash of the repository's git dir
+ * @param entry Filled with the results
+ * @return false if there are none
+ */
+static bool cacheGet(const uint64_t gitdir, Cached &entry) {
+    Cached *entries = cacheMap();
+    if (entries == nullptr) { return false; }
+
+    for (size_t i = 0, pos = gitdir % GIT_CACHE_SLOTS; i < GIT_CACHE_PROBE; ++i, pos = (pos + 1) % GIT_CACHE_SLOTS) {
+        // Copy the entry out before checking it, another prompt may be writing to it right now
+        entry = entries[pos];
+        if (entry.gitdir == gitdir && entry.check == checksum(entry)) { return true; }
+    }
+
+    return false;
+}
+
+/**
+ * Store the results for a repository
+ * @param entry The results, with everything but check filled in
+ */
+static void cachePut(Cached entry) {
+    Cached *entries = cacheMap();
+    if (entries == nullptr) { return; }
+
+    entry.check = checksum(entry);
+
+    // Reuse a slot that already holds this repository or is empty. If there is none, evict the first slot.
+    const size_t first = entry.gitdir % GIT_CACHE_SLOTS;
+    size_t target = first;
+    for (size_t i = 0, pos = first; i < GIT_CACHE_PROBE; ++i, pos = (pos + 1) % GIT_CACHE_SLOTS) {
+        const Cached &cur = entries[pos];
+        if (cur.gitdir == entry.gitdir || cur.check == 0) {
+            target = pos;
+            break;
+        }
+    }
+
+    entries[target] = entry;
+}
+
+std::optional<Git> Git::head(const string &dir) {
+    const auto repo = findRepo(dir);
+    if (!repo) { return {}; }
+
+    Git result;
+    result.branch = readHead(repo->gitdir);
+    return result;
+}
+
+std::optional<Git> Git::collect(const string &dir, const bool cached) {
+    const auto repo = findRepo(dir);
+    if (!repo) { return {}; }
+
+    Git result;
+    result.branch = readHead(repo->gitdir);
+
+    const string index_path = repo->gitdir + "/index";
+    struct stat info {};
+    stat(index_path.c_str(), &info);
+
+    const uint64_t key = fnv(repo->gitdir.data(), repo->gitdir.size());
+    const auto start = steady::now();
+    const int64_t now = std::chrono::nanoseconds(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // Only the stat data is compared, so a modified file stays modified until the index is written again.
+    // Anything else can change without the index changing, so it is only reused for a while.
+    bool check_dirty = true;
+    bool check_untracked = true;
+    if (Cached prev {}; cached && cacheGet(key, prev)) {
+        if (prev.mtime_sec == info.st_mtim.tv_sec && prev.mtime_nsec == info.st_mtim.tv_nsec
+            && prev.size == info.st_size && prev.ino == static_cast<uint64_t>(info.st_ino)) {
+            // A check from the future means the clock was set back, so it can't be told how old it is
+            const bool fresh = now >= prev.checked && now - prev.checked < prev.reuse;
+            if (prev.dirty || fresh) {
+                result.dirty = prev.dirty;
+                check_dirty = false;
+            }
+            if (fresh) {
+                result.untracked = prev.untracked;
+                check_untracked = false;
+            }
+        }
+    }
+
+    if (!check_dirty && !check_untracked) { return result; }
+
+    const int root_fd = open(repo->worktree.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd == -1) { return result; }
+
+    Index index;
+    if (readIndex(index_path, root_fd, check_dirty, index, result.dirty)) {
+        if (check_untracked) { result.untracked = findUntracked(root_fd, repo->gitdir, index); }
+
+        // The longer the check took, the longer it is reused for, so a large repository isn't checked on every prompt
+        const auto reuse = std::clamp<std::chrono::nanoseconds>((steady::now() - start) * GIT_CACHE_SCALE,
+                                                                 std::chrono::milliseconds(GIT_CACHE_AGE),
+                                                                 std::chrono::milliseconds(GIT_CACHE_MAX));
+
+        Cached entry {};
+        entry.gitdir = key;
+        entry.mtime_sec = info.st_mtim.tv_sec;
+        entry.mtime_nsec = info.st_mtim.tv_nsec;
+        entry.size = info.st_size;
+        entry.ino = info.st_ino;
+        entry.checked = now;
+        entry.reuse = reuse.count();
+        entry.dirty = result.dirty;
+        entry.untracked = result.untracked;
+        cachePut(entry);
+    }
+
+    close(root_fd);
+
+    return result;
+}
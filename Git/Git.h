@@ -0,0 +1,39 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+using std::string;
+
+/**
+ * The state of the git repository containing a directory. Everything is read straight from the repository: the
+ * branch from HEAD, and modified files by comparing the stat data cached in the index against the work tree,
+ * the same way git itself does before it looks at file contents. git is never run.
+ *
+ * Only the work tree is compared against the index. Changes that are staged but not committed don't count, as
+ * finding those means reading the commit's tree out of the object store.
+ */
+class Git {
+public:
+    string branch; // Checked out branch, or the abbreviated commit if HEAD is detached
+    bool dirty = false; // A tracked file was modified or deleted, or is unmerged or only added with -N
+    bool untracked = false; // There are untracked files. Only GIT_UNTRACKED_MAX entries are looked at to find one.
+
+    /**
+     * Find the repository containing a directory, and get its state
+     * @param dir Directory to start looking from
+     * @param cached Whether results can be reused from an earlier call, in this process or another. A cached result is
+     * reused while the index stays the same, and for a while if the work tree was clean. How long depends on how long
+     * the tree took to check (see GIT_CACHE_AGE).
+     * @return The state of the repository, or nothing if dir is not in a repository
+     */
+    static std::optional<Git> collect(const string &dir, bool cached = true);
+
+    /**
+     * Find the repository containing a directory, and only read its branch. The work tree isn't looked at, so this is
+     * quick in any repository. dirty and untracked are left unset.
+     * @param dir Directory to start looking from
+     * @return The branch of the repository, or nothing if dir is not in a repository
+     */
+    static std::optional<Git> head(const string &dir);
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * 64 bit FNV-1a hash
+ * @param data Bytes to hash
+ * @param size Number of bytes to hash
+ * @param hash Hash to continue from
+ * @return The hash
+ */
+inline uint64_t fnv(const void *data, const size_t size, uint64_t hash = 0xcbf29ce484222325) {
+    const auto *bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Longest (normalized) distro name that can be looked up
+#define ICON_NAME_MAX 64
+
+struct Icon {
+    std::string_view name;
+    std::string_view icon;
+};
+
+/**
+ * A table of distro icons, built entirely at compile time. Lookups use a perfect hash, so finding an icon is a single
+ * hash of the name and one comparison, with no allocations and no static initialization.
+ *
+ * Names are normalized before they are hashed: ' ', '-' and '_' are dropped and everything is lowercased. This is
+ * done in the same pass as hashing, so "Arch Linux", "arch-linux" and "archlinux" all find the same icon.
+ */
+template <size_t N>
+class IconTable {
+    // Twice as many slots as icons, so finding a displacement for every bucket is quick
+    static constexpr size_t SLOTS = std::bit_ceil(2 * N);
+
+    std::array<Icon, SLOTS> slots {};
+    std::array<uint32_t, N> displace {};
+
+    static constexpr bool skip(const char chr) { return chr == ' ' || chr == '-' || chr == '_'; }
+    static constexpr char lower(const char chr) { return chr >= 'A' && chr <= 'Z' ? chr - 'A' + 'a' : chr; }
+
+    /**
+     * Mix a name's hash with a displacement (the splitmix64 finalizer)
+     */
+    static constexpr uint64_t mix(uint64_t hash, const uint32_t displacement) {
+        hash += displacement * 0x9e3779b97f4a7c15;
+        hash = (hash ^ hash >> 30) * 0xbf58476d1ce4e5b9;
+        hash = (hash ^ hash >> 27) * 0x94d049bb133111eb;
+        return hash ^ hash >> 31;
+    }
+
+    /**
+     * Normalize and hash a name in a single pass (64 bit FNV-1a over the normalized name)
+     * @param name The name
+     * @param out Filled with the normalized name
+     * @param len Set to the length of the normalized name
+     * @return The hash, or 0 if the normalized name is longer than ICON_NAME_MAX
+     */
+    static constexpr uint64_t hash(const std::string_view name, char (&out)[ICON_NAME_MAX], size_t &len) {
+        uint64_t hash = 0xcbf29ce484222325;
+        len = 0;
+
+        for (const char chr : name) {
+            if (skip(chr)) { continue; }
+            if (len == ICON_NAME_MAX) { return 0; }
+
+            out[len++] = lower(chr);
+            hash ^= static_cast<unsigned char>(out[len - 1]);
+            hash *= 0x100000001b3;
+        }
+
+        return hash;
+    }
+
+public:
+    /**
+     * Build the table. This can only run at compile time, and fails to compile if two icons share a name.
+     * @param icons Every icon. Names should already be normalized.
+     */
+    consteval IconTable(const Icon (&icons)[N]) { // NOLINT(*-explicit-constructor)
+        std::array<uint64_t, N> hashes {};
+        std::array<size_t, N> sizes {}; // Number of icons in every bucket
+
+        for (size_t i = 0; i < N; ++i) {
+            char name[ICON_NAME_MAX];
+            size_t len;
+            hashes[i] = hash(icons[i].name, name, len);
+            if (len != icons[i].name.size()) { throw "icon names must be normalized"; }
+            ++sizes[mix(hashes[i], 0) % N];
+
+            // Two icons with the same name could never be told apart
+            for (size_t j = 0; j < i; ++j)
+                if (icons[j].name == icons[i].name) { throw "duplicate icon name"; }
+        }
+
+        // Place the biggest buckets first, while there are still lots of free slots
+        std::array<size_t, N> order {};
+        for (size_t i = 0; i < N; ++i) { order[i] = i; }
+        for (size_t i = 1; i < N; ++i)
+            for (size_t j = i; j > 0 && sizes[order[j]] > sizes[order[j - 1]]; --j)
+                std::swap(order[j], order[j - 1]);
+
+        std::array<bool, SLOTS> used {};
+
+        for (const size_t bucket : order) {
+            if (sizes[bucket] == 0) { break; }
+
+            // Find a displacement that puts every icon in the bucket in a different free slot
+            for (uint32_t d = 1;; ++d) {
+                if (d == 1u << 20) { throw "could not build a perfect hash for the icons"; }
+
+                std::array<bool, SLOTS> taken = used;
+                bool fits = true;
+
+                for (size_t i = 0; i < N && fits; ++i) {
+                    if (mix(hashes[i], 0) % N != bucket) { continue; }
+
+                    const size_t slot = mix(hashes[i], d) % SLOTS;
+                    if (taken[slot]) { fits = false; }
+                    taken[slot] = true;
+                }
+
+                if (!fits) { continue; }
+
+                for (size_t i = 0; i < N; ++i)
+                    if (mix(hashes[i], 0) % N == bucket) { slots[mix(hashes[i], d) % SLOTS] = icons[i]; }
+
+                used = taken;
+                displace[bucket] = d;
+                break;
+            }
+        }
+    }
+
+    /**
+     * Find the icon for a distro
+     * @param name Name of the distro. It is normalized before it is looked up.
+     * @return The icon, or an empty string if there is no icon for the distro
+     */
+    [[nodiscard]] constexpr std::string_view find(const std::string_view name) const {
+        char normal[ICON_NAME_MAX];
+        size_t len;
+        const uint64_t key = hash(name, normal, len);
+        if (key == 0) { return {}; }
+
+        const Icon &slot = slots[mix(key, displace[mix(key, 0) % N]) % SLOTS];
+        return slot.name == std::string_view{normal, len} ? slot.icon : std::string_view{};
+    }
+
+    [[nodiscard]] static constexpr size_t size() { return N; }
+
+    [[nodiscard]] constexpr auto begin() const { return slots.begin(); }
+    [[nodiscard]] constexpr auto end() const { return slots.end(); }
+};
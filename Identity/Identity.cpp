@@ -0,0 +1,215 @@
+#include "Identity.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <fcntl.h>
+#include <pwd.h>
+#include <unistd.h>
+#include <utmp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../config.h"
+#include "../icons.h"
+#include "../Hash/Hash.h"
+#include "../Reader/Reader.h"
+#include "../Root/Root.h"
+
+// How many slots to look at for a record, starting from the one its session hashes to
+#define ID_PROBE 4
+
+struct Record {
+    int64_t sid;
+    int64_t os_sec; // mtime of /etc/os-release when the record was made
+    int64_t os_nsec;
+    int32_t remote;
+    char tty[UT_LINESIZE + 1];
+    char host[HOST_NAME_MAX + 1];
+    char user[UT_NAMESIZE + 1];
+    char icon[16];
+    char pad[1]; // Would be padding otherwise, which isn't copied reliably, and is hashed along with everything else
+    uint32_t check; // Hash of every other field, 0 if the slot is empty
+};
+
+// Records are checksummed byte by byte, so there must not be any padding in the part that is hashed
+static_assert(offsetof(Record, check) == sizeof(Record::sid) + sizeof(Record::os_sec) + sizeof(Record::os_nsec)
+              + sizeof(Record::remote) + sizeof(Record::tty) + sizeof(Record::host) + sizeof(Record::user)
+              + sizeof(Record::icon) + sizeof(Record::pad), "Record has padding");
+
+/**
+ * Get the checksum of a record. Lets us spot records that were torn by two prompts writing at once.
+ */
+static uint32_t checksum(const Record &record) {
+    const uint64_t hash = fnv(&record, offsetof(Record, check));
+    // An empty slot must never look valid
+    return static_cast<uint32_t>(hash ^ hash >> 32) | 1;
+}
+
+/**
+ * Map the shared page holding the records, creating it if it doesn't exist. The page is per-user.
+ * @return The mapped records, or nullptr if the page could not be mapped
+ */
+static Record *mapRecords() {
+    constexpr size_t size = sizeof(Record) * ID_SLOTS;
+
+    const string name = ID_PAGE_NAME "." + std::to_string(getuid());
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd == -1) { return nullptr; }
+
+    // A freshly truncated page is zero-filled, which marks every slot as empty
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || (static_cast<size_t>(info.st_size) != size && ftruncate(fd, size) != 0)) {
+        close(fd);
+        return nullptr;
+    }
+
+    void *page = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    return page == MAP_FAILED ? nullptr : static_cast<Record*>(page);
+}
+
+/**
+ * Look up a tty in the utmp file. The utmp functions keep their state in globals, so this must not run on two threads
+ * at once.
+ * @param tty The tty to look up, without the leading /dev/
+ * @return 1 if the tty belongs to a ssh session, 0 if it does not, -1 if the tty is not in the utmp file
+ */
+static int lookupRemote(const string &tty) {
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+    utmp udata {.ut_type = USER_PROCESS};
+    #pragma GCC diagnostic pop
+
+    // remote access status can be found in the utmp file, that we can search by
+    // looking up our tty with getutline().
+    strncpy(udata.ut_line, tty.c_str(), sizeof udata.ut_line);
+    // Resets to the beginning of the utmp file
+    utmpname(Root::path(_PATH_UTMP).c_str());
+    setutent();
+    // Get the correct utmp entry
+    const utmp *data = getutline(&udata);
+    const int remote = data == nullptr ? -1 : data->ut_addr_v6[0] != 0;
+    endutent();
+
+    // If connected via ssh, the ip address will be stored in ut_addr_v6.
+    // This is true even if the user is connected via ipv4 - the address is just
+    // stored in the first element of the array.
+    return remote;
+}
+
+/**
+ * Get the name of the current user. Uses getlogin_r(), and falls back on the password database if we don't have a
+ * controlling terminal (e.g. when running as a daemon).
+ * @return The name of the current user
+ */
+static string getUser() {
+    char buf[1024];
+    if (getlogin_r(buf, sizeof buf) == 0) { return buf; }
+
+    passwd pw {};
+    passwd *found = nullptr;
+    if (getpwuid_r(getuid(), &pw, buf, sizeof buf, &found) == 0 && found != nullptr) { return pw.pw_name; }
+    return std::to_string(getuid());
+}
+
+/**
+ * Find the nerd font icon for the current distro by reading /etc/os-release.
+ * @return The icon, or an empty string if we don't know the distro
+ */
+static string findIcon() {
+    char buf[4096];
+    const std::string_view text = Reader::read("/etc/os-release", buf, sizeof buf);
+
+    // The distro name may be quoted
+    std::string_view name = Reader::value(text, "NAME=");
+    if (name.size() >= 2 && name.front() == '"' && name.back() == '"') { name = name.substr(1, name.size() - 2); }
+
+    // The icon table drops all " ", "_", and "-" characters from the name, to improve icon detection
+    return string{icons.find(name)};
+}
+
+/**
+ * Copy a string into a fixed size field, truncating it if needed
+ */
+template <size_t N>
+static void store(char (&field)[N], const string &value) {
+    const size_t size = std::min(value.size(), N - 1);
+    memcpy(field, value.data(), size);
+    field[size] = '\0';
+}
+
+Identity Identity::get(const Context &ctx) {
+    // The page is mapped once, and kept for the life of the process
+    static Record *records = mapRecords();
+
+    // These two are the only things checked on every prompt. A record made before a hostname change
+    // or a distro upgrade is stale.
+    char host[HOST_NAME_MAX + 1] = {};
+    gethostname(host, HOST_NAME_MAX);
+
+    struct stat os {};
+    Root::stat("/etc/os-release", os);
+
+    const uint64_t key = fnv(ctx.tty.data(), ctx.tty.size(), fnv(&ctx.sid, sizeof ctx.sid));
+
+    // The user_host and icon collectors both ask at once. Taking turns means the second one finds the record the
+    // first one just made instead of looking everything up again, and keeps the utmp lookups off two threads at once.
+    static std::mutex lock;
+    const std::lock_guard guard{lock};
+
+    Identity result;
+    // Slot to store a new record in. Prefer our own out of date record, then an empty slot, then evict the first slot.
+    size_t target = key % ID_SLOTS;
+    bool placed = false;
+
+    if (records != nullptr) {
+        for (size_t i = 0, pos = key % ID_SLOTS; i < ID_PROBE; ++i, pos = (pos + 1) % ID_SLOTS) {
+            // Copy the record out before checking it, another prompt may be writing to it right now
+            const Record record = records[pos];
+
+            if (record.check == 0 && !placed) {
+                target = pos;
+                placed = true;
+            }
+            if (record.check != checksum(record) || record.sid != ctx.sid || ctx.tty != record.tty) { continue; }
+
+            // Our record, but possibly out of date
+            target = pos;
+            if (strcmp(record.host, host) != 0 || record.os_sec != os.st_mtim.tv_sec ||
+                record.os_nsec != os.st_mtim.tv_nsec) { break; }
+
+            result.user = record.user;
+            result.host = record.host;
+            result.icon = record.icon;
+            result.remote = record.remote;
+            return result;
+        }
+    }
+
+    result.user = getUser();
+    result.host = host;
+    result.icon = findIcon();
+    result.remote = lookupRemote(ctx.tty);
+
+    if (records != nullptr) {
+        Record record {};
+        record.sid = ctx.sid;
+        record.os_sec = os.st_mtim.tv_sec;
+        record.os_nsec = os.st_mtim.tv_nsec;
+        record.remote = result.remote;
+        store(record.tty, ctx.tty);
+        store(record.host, result.host);
+        store(record.user, result.user);
+        store(record.icon, result.icon);
+        record.check = checksum(record);
+
+        records[target] = record;
+    }
+
+    return result;
+}
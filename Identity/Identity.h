@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+
+#include "../Context/Context.h"
+
+using std::string;
+
+/**
+ * Facts about a shell that stay the same for its whole session: who we are, where we are, how we got here and what
+ * we are running on. They are looked up once per session and tty, and kept in a shared memory page, so every prompt
+ * after the first only has to read them back. A record is thrown out if the hostname or /etc/os-release changes.
+ */
+class Identity {
+public:
+    string user;
+    string host;
+    string icon; // Nerd font icon for the distro, or empty if the distro is unknown
+    int remote = -1; // 1 if the session is over ssh, 0 if it is not, -1 if the tty is not in the utmp file
+
+    /**
+     * Get the identity of a shell
+     * @param ctx The shell to look up
+     * @return The shell's identity
+     */
+    static Identity get(const Context &ctx);
+};
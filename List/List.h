@@ -1,92 +1,132 @@
 #pragma once
-#include <string>
+#include <cstddef>
 #include <iterator>
+#include <new>
+#include <string>
+#include <utility>
+
+/**
+ * A contiguous list with room for N elements inline. Appending only allocates once the list grows past N elements,
+ * and every element lives next to the one before it, so iterating is just walking a pointer.
+ *
+ * Pointers returned by Append() are only valid until the next Append().
+ */
+template <typename T, size_t N = 8>
+class List {
+    alignas(T) unsigned char storage[N * sizeof(T)];
+    T* items = reinterpret_cast<T*>(storage);
+    size_t count = 0;
+    size_t capacity = N;
+
+    [[nodiscard]] bool isInline() const { return items == reinterpret_cast<const T*>(storage); }
+
+    /**
+     * Move every element into a bigger allocation
+     */
+    void grow() {
+        const size_t new_capacity = capacity * 2;
+        T* moved = static_cast<T*>(::operator new(new_capacity * sizeof(T), std::align_val_t{alignof(T)}));
+
+        for (size_t i = 0; i < count; ++i) {
+            new (moved + i) T(std::move(items[i]));
+            items[i].~T();
+        }
+
+        release();
+        items = moved;
+        capacity = new_capacity;
+    }
 
-template <typename T>
-class List;
-
-template <typename T>
-class Node {
-    friend class List<T>;
-    T data;
-    [[nodiscard]] std::string _toString(std::string str) const {
-        str += data;
-        if (next != nullptr) return next->_toString(str);
-        return str;
+    /**
+     * Free the current allocation, if there is one. Elements must already be destroyed.
+     */
+    void release() {
+        if (!isInline()) { ::operator delete(items, std::align_val_t{alignof(T)}); }
+        items = reinterpret_cast<T*>(storage);
+        capacity = N;
     }
-    [[nodiscard]] std::string _toString(std::string str, const std::string& sep) const {
-        str += data;
-        if (next->next != nullptr) return next->_toString(str + sep, sep);
-        return str;
+
+    void destroy() {
+        for (size_t i = 0; i < count; ++i) { items[i].~T(); }
+        count = 0;
+        release();
     }
+
 public:
-    Node* next = nullptr;
-    Node() = default;
-    explicit Node(T& data) : data(data) {}
-    T& operator*() { return data; }
-    [[nodiscard]] std::string toString() const { return this->_toString(""); };
-    [[nodiscard]] std::string toString(const std::string& sep) const { return this->_toString("", sep); };
-};
+    List() = default;
 
-template <typename T>
-class Iter {
-    Node<T>* pos;
+    List(const List& other) {
+        for (const T& item : other) { Append(item); }
+    }
 
-public:
-    explicit Iter(Node<T>* pos) : pos(pos) {}
-    Iter() : pos(nullptr) {}
-    explicit Iter(const Node<T>* pos) : pos(pos) {}
-    using difference_type = std::ptrdiff_t;
-    using value_type = T;
-
-    Iter& operator++() { pos = pos->next; return *this; }
-
-    Iter operator++(int) {
-        Iter tmp(pos);
-        ++pos;
-        return tmp;
+    List(List&& other) noexcept {
+        if (other.isInline()) {
+            for (T& item : other) { Append(std::move(item)); }
+            other.destroy();
+        } else {
+            // Take over the allocation, and leave other empty
+            items = std::exchange(other.items, reinterpret_cast<T*>(other.storage));
+            count = std::exchange(other.count, 0);
+            capacity = std::exchange(other.capacity, N);
+        }
     }
 
-    [[nodiscard]] Node<T> *peek() const { return pos->next; }
+    List& operator=(const List& other) {
+        if (this != &other) {
+            destroy();
+            for (const T& item : other) { Append(item); }
+        }
+        return *this;
+    }
 
-    bool operator==(const Iter & end) const { return end.pos == this->pos; }
-    T& operator*() const { return **pos; }
+    List& operator=(List&& other) noexcept {
+        if (this != &other) {
+            destroy();
+            new (this) List(std::move(other));
+        }
+        return *this;
+    }
 
-    [[nodiscard]] std::string toString() const { return pos->toString(); }
-    [[nodiscard]] std::string toString(const std::string& sep) const { return pos->toString(sep); };
-};
+    ~List() { destroy(); }
 
-static_assert(std::forward_iterator<Iter<std::string>>);
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
 
-template <typename T>
-class List {
-    Node<T>* head = nullptr;
-    Node<T>* tail = nullptr;
+    T& operator[](const size_t i) { return items[i]; }
+    const T& operator[](const size_t i) const { return items[i]; }
 
-    T* (List::*_append)(T&) = &List::append_first;
+    [[nodiscard]] size_t size() const { return count; }
+    [[nodiscard]] bool empty() const { return count == 0; }
 
-    T* append_first(T &value) {
-        head = new Node<T>(value);
-        tail = head->next = new Node<T>();
-        _append = &List::append_subsequent;
-        return &head->data;
+    T* Append(T value) {
+        if (count == capacity) { grow(); }
+        return new (items + count++) T(std::move(value));
     }
 
-    T* append_subsequent(T &value) {
-        **tail = value;
-        T *ptr = &tail->data;
-        tail = tail->next = new Node<T>();
-        return ptr;
-    }
+    [[nodiscard]] std::string toString() const { return toString(""); }
 
-public:
-    List() = default;
-    Iter<T> begin() const { return Iter(head); }
-    Iter<T> end() const { return Iter<T>(tail); }
-    T* Append(T value) {
-        return (this->*_append)(value);
+    /**
+     * Join every element into a single string
+     * @param sep Separator to put between elements
+     * @return The joined string
+     */
+    [[nodiscard]] std::string toString(const std::string& sep) const {
+        // Work out the final size first, so the string is only allocated once
+        size_t size = count > 0 ? sep.size() * (count - 1) : 0;
+        for (const T& item : *this) { size += std::size(item); }
+
+        std::string str;
+        str.reserve(size);
+
+        for (size_t i = 0; i < count; ++i) {
+            if (i > 0) str += sep;
+            str += items[i];
+        }
+
+        return str;
     }
+};
 
-    [[nodiscard]] std::string toString() const { return head->toString(); }
-    [[nodiscard]] std::string toString(const std::string& sep) const { return head->toString(sep); };
-};
\ No newline at end of file
+static_assert(std::contiguous_iterator<decltype(std::declval<List<std::string>&>().begin())>);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#include "../Width/Width.h"
+
+/**
+ * A string that is fixed at compile time, along with its display width. Literals are joined with + at compile time,
+ * so the colors, separators and icons that make up the static parts of the prompt cost nothing to build, and their
+ * widths never have to be counted by hand.
+ *
+ *     static constexpr Literal SEP = fore::DEFAULT + " " + chars::R_SEP + " ";
+ *     static_assert(SEP.width == 3);
+ */
+template <size_t N>
+struct Literal {
+    char data[N + 1] {};
+    size_t width = 0;
+
+    constexpr Literal() = default;
+
+    // ReSharper disable once CppNonExplicitConvertingConstructor
+    consteval Literal(const char (&str)[N + 1]) { // NOLINT(*-explicit-constructor)
+        for (size_t i = 0; i < N; ++i) data[i] = str[i];
+        width = Width::of(*this);
+    }
+
+    [[nodiscard]] static constexpr size_t size() { return N; }
+
+    // ReSharper disable once CppNonExplicitConversionOperator
+    constexpr operator std::string_view() const { return {data, N}; } // NOLINT(*-explicit-constructor)
+
+    template <size_t M>
+    consteval Literal<N + M> operator+(const Literal<M> &other) const {
+        Literal<N + M> result;
+        for (size_t i = 0; i < N; ++i) result.data[i] = data[i];
+        for (size_t i = 0; i < M; ++i) result.data[N + i] = other.data[i];
+        result.width = width + other.width;
+        return result;
+    }
+
+    template <size_t M>
+    consteval Literal<N + M - 1> operator+(const char (&str)[M]) const { return *this + Literal<M - 1>(str); }
+};
+
+template <size_t N>
+Literal(const char (&)[N]) -> Literal<N - 1>;
+
+template <size_t N, size_t M>
+consteval Literal<N + M - 1> operator+(const char (&str)[M], const Literal<N> &lit) { return Literal<M - 1>(str) + lit; }
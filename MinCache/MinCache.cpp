@@ -0,0 +1,122 @@
+#include "MinCache.h"
+
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "../config.h"
+#include "../Hash/Hash.h"
+#include "../Runtime/Runtime.h"
+
+// Identifies a cache file in the current layout. Change this whenever Entry or Header changes.
+#define MIN_CACHE_MAGIC 0x6d696e31
+// How many slots to look at for an entry, starting from the one its key hashes to
+#define MIN_CACHE_PROBE 4
+
+MinCache::Entry *MinCache::map() {
+    // Mapped once, and kept for the life of the process
+    static Entry *entries = [] () -> Entry* {
+        constexpr size_t size = sizeof(Header) + sizeof(Entry) * MIN_CACHE_SLOTS;
+
+        const int fd = Runtime::open(MIN_CACHE_NAME, O_RDWR | O_CREAT);
+        if (fd == -1) { return nullptr; }
+
+        struct stat info {};
+        if (fstat(fd, &info) != 0 || (static_cast<size_t>(info.st_size) < size && ftruncate(fd, size) != 0)) {
+            close(fd);
+            return nullptr;
+        }
+
+        void *page = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (page == MAP_FAILED) { return nullptr; }
+
+        // A new file, or one from an older version of the cache - start over
+        auto *header = static_cast<Header*>(page);
+        if (header->magic != MIN_CACHE_MAGIC || header->slots != MIN_CACHE_SLOTS) {
+            memset(page, 0, size);
+            header->slots = MIN_CACHE_SLOTS;
+            header->magic = MIN_CACHE_MAGIC;
+        }
+
+        return reinterpret_cast<Entry*>(header + 1);
+    }();
+
+    return entries;
+}
+
+uint32_t MinCache::checksum(const Entry &entry) {
+    const uint64_t hash = fnv(&entry, offsetof(Entry, check));
+    // A zeroed slot must never look valid
+    return static_cast<uint32_t>(hash ^ hash >> 32) | 1;
+}
+
+/**
+ * Build an entry with only its key filled in
+ * @param dir stat() of the directory holding the element
+ * @param name Name of the element
+ * @return The entry
+ */
+MinCache::Entry MinCache::key(const struct stat &dir, const string &name) {
+    Entry entry {};
+    entry.dev = dir.st_dev;
+    entry.ino = dir.st_ino;
+    entry.mtime_sec = dir.st_mtim.tv_sec;
+    entry.mtime_nsec = dir.st_mtim.tv_nsec;
+    entry.name = fnv(name.data(), name.size());
+    return entry;
+}
+
+/**
+ * Check whether two entries are for the same element
+ */
+bool MinCache::same(const Entry &a, const Entry &b) {
+    return a.dev == b.dev && a.ino == b.ino && a.mtime_sec == b.mtime_sec && a.mtime_nsec == b.mtime_nsec
+           && a.name == b.name;
+}
+
+/**
+ * Get the first slot to look in for an entry
+ */
+size_t MinCache::slot(const Entry &entry) {
+    return fnv(&entry, offsetof(Entry, len)) % MIN_CACHE_SLOTS;
+}
+
+size_t MinCache::get(const struct stat &dir, const string &name) {
+    Entry *entries = map();
+    if (entries == nullptr) { return 0; }
+
+    const Entry want = key(dir, name);
+
+    for (size_t i = 0, pos = slot(want); i < MIN_CACHE_PROBE; ++i, pos = (pos + 1) % MIN_CACHE_SLOTS) {
+        // Copy the entry out before checking it, another prompt may be writing to it right now
+        const Entry entry = entries[pos];
+        if (same(entry, want) && entry.check == checksum(entry)) { return entry.len; }
+    }
+
+    return 0;
+}
+
+void MinCache::put(const struct stat &dir, const string &name, const size_t len) {
+    Entry *entries = map();
+    if (entries == nullptr) { return; }
+
+    Entry entry = key(dir, name);
+    entry.len = len;
+    entry.check = checksum(entry);
+
+    // Reuse a slot that already holds this element or is empty. If there is none, evict the first slot.
+    const size_t first = slot(entry);
+    size_t target = first;
+    for (size_t i = 0, pos = first; i < MIN_CACHE_PROBE; ++i, pos = (pos + 1) % MIN_CACHE_SLOTS) {
+        const Entry &cur = entries[pos];
+        if (same(cur, entry) || cur.check == 0) {
+            target = pos;
+            break;
+        }
+    }
+
+    entries[target] = entry;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <sys/stat.h>
+
+using std::string;
+
+/**
+ * A cache of minimized path elements, shared between every prompt through a file mapped from the runtime dir.
+ * Entries are keyed by the device, inode and mtime of the directory holding the element, so adding, removing or
+ * renaming anything in that directory invalidates every entry for it.
+ */
+class MinCache {
+    struct Entry {
+        uint64_t dev;
+        uint64_t ino;
+        int64_t mtime_sec;
+        int64_t mtime_nsec;
+        uint64_t name; // Hash of the element's name
+        uint32_t len; // Length of the element's shortest unique prefix
+        uint32_t check; // Hash of every other field. Lets us spot entries that were torn by two prompts writing at once.
+    };
+
+    struct Header {
+        uint32_t magic;
+        uint32_t slots;
+    };
+
+    static Entry *map();
+    static uint32_t checksum(const Entry &entry);
+    static Entry key(const struct stat &dir, const string &name);
+    static bool same(const Entry &a, const Entry &b);
+    static size_t slot(const Entry &entry);
+public:
+    /**
+     * Look up the minimized length of a path element
+     * @param dir stat() of the directory holding the element
+     * @param name Name of the element
+     * @return The length of the shortest unique prefix of name, or 0 if it is not cached
+     */
+    static size_t get(const struct stat &dir, const string &name);
+
+    /**
+     * Store the minimized length of a path element
+     * @param dir stat() of the directory holding the element
+     * @param name Name of the element
+     * @param len The length of the shortest unique prefix of name
+     */
+    static void put(const struct stat &dir, const string &name, size_t len);
+};
@@ -1,182 +1,311 @@
 #include "Path.h"
 
-#include <csignal>
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstdint>
 #include <cstring>
 #include <fcntl.h>
-#include <iostream>
-#include <pwd.h>
 #include <unistd.h>
-#include <dirent.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 
+#include "../Config/Config.h"
 #include "../List/List.h"
-#include "../term.h"
-#include "../Segment/Segment.h"
+#include "../Context/Context.h"
+#include "../MinCache/MinCache.h"
+#include "../Width/Width.h"
 
 
 #define SEP '/'
+// Size of the buffer directory entries are read into. Each getdents64 call fills as much of it as it can.
+#define DENTS_BUF (64 * 1024)
+
+// glibc doesn't declare this, as it expects everyone to use readdir()
+struct linux_dirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
 
-class Segment;
 /**
- * Get the homedir of the user. Uses $HOME, and falls back on looking the user up in
- * the password database if $HOME is unset.
- * @return A string representing the current user's homedir
+ * Check if a directory can be read and written to by the current user. This goes by the effective ids, and leaves
+ * the decision to the kernel, so ACLs and supplementary groups are taken into account.
+ * @param dir_fd Handle on the directory's parent, or -1 if it couldn't be opened
+ * @param name Name of the directory in its parent, or "." if dir_fd is the directory itself
+ * @return True if the current user has read/write access to the directory
  */
-string getHome() {
-    char* buf = std::getenv("HOME");
-    // If HOME is unset, fall back on our homedir in the password database
-    if (buf == nullptr) { buf = getpwuid(getuid())->pw_dir; }
-
-    // Convert from char* to string
-    string home(buf);
-    // If home has a trailing /, remove it
-    if (home.ends_with(SEP)) { home.erase(home.size() - 1); }
+bool Path::canAccess(const int dir_fd, const char *name) {
+    return dir_fd != -1 && faccessat(dir_fd, name, R_OK | W_OK, AT_EACCESS) == 0;
+}
 
-    return home;
+/**
+ * Check whether a path is a directory or anywhere inside it
+ * @param path Path to check, with or without a trailing separator
+ * @param dir Directory, without a trailing separator
+ */
+static bool inDir(const std::string_view path, const std::string_view dir) {
+    return !dir.empty() && path.starts_with(dir) && (path.size() == dir.size() || path[dir.size()] == SEP);
 }
 
 /**
- * Check if a given path can be read and written to by the current user
- * @param path Path to check
- * @return True if the current user has read/write access to path
+ * Count how many bytes at the start of two strings are the same, comparing a word at a time.
+ * Both strings must be readable for at least max bytes, rounded up to a multiple of 8.
+ * @param a First string
+ * @param b Second string
+ * @param max Stop comparing after this many bytes
+ * @return The length of the common prefix of a and b, up to max
  */
-bool Path::canAccess(const char* path) {
-    struct stat info; // NOLINT(*-pro-type-member-init)
-    stat(path, &info);
-
-    // If we own pwd, assume we have read/write access
-    if (info.st_uid == getuid()) return true;
-    // If we don't own pwd, check if others have read/write access
-    if (info.st_mode & S_IWOTH && info.st_mode & S_IROTH) return true;
-    // If others don't have read_write access, check if group members have read/write access
-    // If this is true, we need to loop through current user's groups to see if we have access
-    if (info.st_mode & S_IWGRP && info.st_mode & S_IROTH) {
-        const int group_count = getgroups(0, nullptr); // Gets a count of the current user's groups
-        // We need to be one larger than group_count because user's egid is not guaranteed to be in group_count
-        auto *groups = (unsigned int*) malloc(sizeof(int) * (group_count + 1));
-        getgroups(group_count, groups);
-        groups[group_count] = getegid();
-
-        // If any of our groups matches pwd's group, we have read/write access
-        for (int i = 0; i < group_count + 1; i++ )
-            if (groups[i] == info.st_gid) {
-                free(groups);
-                return true;
-            }
-        free(groups);
+static size_t common(const char *a, const char *b, const size_t max) {
+    size_t i = 0;
+
+    if constexpr (std::endian::native == std::endian::little) {
+        for (; i < max; i += sizeof(uint64_t)) {
+            uint64_t x, y;
+            memcpy(&x, a + i, sizeof x);
+            memcpy(&y, b + i, sizeof y);
+            // On a little endian machine, the lowest set bit of the difference is in the first byte that differs
+            if (x != y) { return std::min(max, i + std::countr_zero(x ^ y) / 8); }
+        }
+        return max;
     }
-    return false;
+
+    for (; i < max; ++i) { if (a[i] != b[i]) { return i; } }
+    return max;
 }
 
-size_t Path::minimize(string &raw_path, string &path) {
-    // Each path element must be at least 1 character long
-    string min {path[0]};
+size_t Path::shortest(const int dir_fd, const string &name) {
+    // The handle may only be good for lookups, so the directory is opened again for reading
+    const int fd = openat(dir_fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) { return 0; }
 
-    // Loop over every directory
-    DIR *dp = opendir(raw_path.c_str());
+    const size_t size = name.size();
 
-    // Get the directory info for the current path element.
-    // This is so we can get the inode.
-    struct stat dir_info; // NOLINT(*-pro-type-member-init)
-    fstatat(dirfd(dp), path.c_str(), &dir_info, 0);
+    // name, padded with NULs so that it can be compared a word at a time. Comparing the NUL at the end of name
+    // as well means that a sibling that is a prefix of name is caught too.
+    char target[NAME_MAX + 1 + sizeof(uint64_t)] = {};
+    memcpy(target, name.data(), std::min(size, static_cast<size_t>(NAME_MAX)));
 
-    while (const dirent *ep = readdir(dp)) {
+    // Each path element must be at least 1 character long
+    size_t min = 1;
 
-        // Since readdir will eventually find the target
-        // path in raw_path, we need to skip it.
-        if (ep->d_ino == dir_info.st_ino) continue;
+    // getdents64 fills this with as many entries as will fit. The slack at the end is never filled, it only makes
+    // sure that comparing a word at a time never reads past the end of the buffer.
+    alignas(linux_dirent64) char buf[DENTS_BUF + sizeof(uint64_t)];
 
-        // If ep is smaller than path, we can ignore everything after the end of ep
-        size_t max = std::min(path.size(), strlen(ep->d_name));
+    // Stop as soon as name can't get any shorter
+    while (min < size) {
+        const long got = syscall(SYS_getdents64, fd, buf, DENTS_BUF);
+        if (got <= 0) { break; }
 
-        // Loop through the string and look for any differences
-        for (size_t i = 0; i < max; ++i) {
-            if (ep->d_name[i] != path[i]) {
-                if (i >= min.size()) min += path[i];
-                break;
-            }
+        for (long pos = 0; pos < got && min < size; ) {
+            const auto *ep = reinterpret_cast<const linux_dirent64*>(buf + pos);
+            pos += ep->d_reclen;
+
+            // Compare one byte past the end of name, to pick up the NUL at the end of the entry's name
+            const size_t same = common(ep->d_name, target, size + 1);
 
-            if (i >= min.size()) min += path[i];
+            // Since we will eventually find name itself, we need to skip it
+            if (same > size) { continue; }
+
+            // We need one more byte than the sibling shares with us
+            min = std::max(min, same + 1);
         }
     }
-    closedir(dp);
 
-    raw_path += SEP + path;
+    close(fd);
+
+    // Never cut a multibyte character in half
+    min = std::min(min, size);
+    while (min < size && (name[min] & 0xc0) == 0x80) { ++min; }
 
-    size_t diff = path.size() - min.size();
-    path = min;
-    return diff;
+    return min;
 }
 
 /**
- * Add the current working directory to element, minimized. If the current working directory is in the user's homedir,
- * the homedir will br replaced with a ~. This function will attempt to shrink the cwd to fit within max_len, by first
- * shrinking every path element to it's minimum unique length, and then further shrinking as needed. The last path
- * element will always be full-size.
- * @param segment Segment to add directory information to
- * @param max_len Length at which to stop minimizing.
- * @return max_len - the size of the path segment generated.
+ * Find the shortest prefix of a directory entry that is not shared with any other entry in the same directory
+ * @param dir_fd Handle on the directory containing the entry
+ * @param name Name of the entry
+ * @return The shortest unique prefix of name
  */
-size_t Path::addPath(Segment &segment, size_t max_len) {
-    Element *element = segment.Append();
-    string pwd = get_current_dir_name();
+string Path::minimize(const int dir_fd, const string &name) {
+    // Nothing can be added to or removed from a directory without changing its mtime,
+    // so a cached result is good for as long as the directory's mtime stays the same.
+    struct stat dir_stat; // NOLINT(*-pro-type-member-init)
+    const bool cacheable = fstat(dir_fd, &dir_stat) == 0;
+    if (cacheable) {
+        if (const size_t len = MinCache::get(dir_stat, name)) { return name.substr(0, len); }
+    }
+
+    const size_t len = shortest(dir_fd, name);
+    if (len == 0) { return name; }
+
+    if (cacheable) { MinCache::put(dir_stat, name, len); }
+
+    return name.substr(0, len);
+}
+
+/**
+ * Collect the current working directory. If the current working directory is in the user's homedir, the homedir
+ * will be replaced with a ~. Every path element except the last is minimized to it's shortest unique prefix up
+ * front, so that this can run before we know how much space the path will get.
+ * @param ctx The shell to render for. Its pwd and home are used instead of our own.
+ * @param probe If false, the filesystem is not touched at all: nothing is minimized, and access is not checked.
+ * This is for when the filesystem is too slow to answer.
+ * @return The collected path
+ */
+Path Path::collect(const Context &ctx, const bool probe) {
+    Path result;
+
+    string pwd = ctx.pwd;
     // If pwd does not have a trailing slash, add one
     if (! pwd.ends_with(SEP)) { pwd += SEP; }
-    // -2 for the beginning and ending separators, -3 for the icon
-    size_t len = pwd.length() + (2 + 3);
+    // -2 for the beginning and ending separators, -2 for the spaces around the icon
+    result.len = Width::of(pwd) + (2 + 2);
 
-    const string home = getHome();
-    const bool in_home = pwd.starts_with(home);
-    //    const bool in_home = false;
+    const string &home = ctx.home;
+    result.in_home = inDir(pwd, home);
 
-    if (canAccess(pwd.c_str())) { // Check if we have read/write access to pwd
-        if (in_home) element->addIcon(chars::HOME); // If we are in our homedir, use the home icon
-        else element->addIcon(chars::FOLDER); // If we are outside homedir, use the folder icon
+    if (result.in_home) { // If we are in home, use ~ as a replacement for our homedir
+        result.len -= Width::of(home) - 1; // Shrink len - the extra 2 is for the ~ and the etra seperator
+        pwd.erase(0, home.size()); // Remove home from pwd
     }
-    else element->addIcon(chars::LOCK); // If we don't have read/write access, use the lock icon
 
-    element->add(" ");
+    // Walk down from / (or the homedir) once, keeping a handle on the directory we are in. Every element is looked
+    // up relative to its parent, rather than resolving the whole path again for each one. The last element is never
+    // opened, its access is checked through its parent.
+    int dir_fd = probe ? open(result.in_home ? home.c_str() : "/", O_PATH | O_DIRECTORY | O_CLOEXEC) : -1;
+    // The handles are kept open and closed together, for as long as the kernel hands them out in order
+    int first_fd = dir_fd;
 
-    List<string> path; // The actual path, for iterating through
-    List<string> display; // What will be displayed
-    string raw_path; // Plain string, for passing to stat()
+    string last = ".";
 
-    if (in_home) { // If we are in home, use ~ as a replacement for our homedir
-        len -= home.size() - 1; // Shrink len - the extra 2 is for the ~ and the etra seperator
-        pwd.erase(0, home.size()); // Remove home from pwd
+    // Split pwd on SEP, and minimize every element but the last
+    for (size_t head = 1, i = 1; i < pwd.length(); ++i) {
+        if (pwd[i] == SEP) {
+            string name = pwd.substr(head, i - head);
+            head = i + 1;
 
-        raw_path = home;
-        display.Append("~");
+            result.full.Append(name);
+            if (i + 1 == pwd.length()) {
+                result.small.Append(name);
+                if (!name.empty()) { last = std::move(name); }
+                break;
+            }
+            result.small.Append(dir_fd != -1 ? minimize(dir_fd, name) : name);
+
+            // If a directory can't be opened, nothing below it is minimized
+            if (dir_fd != -1 && !name.empty()) {
+                const int next = openat(dir_fd, name.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+                if (next != dir_fd + 1) {
+                    close_range(first_fd, dir_fd, 0);
+                    first_fd = next;
+                }
+                dir_fd = next;
+            }
+        }
     }
 
-    // Split pwd on SEP and fill up path
-    for (size_t head = 1, i = 1; i < pwd.length(); ++i) {
+    const Config::Image &config = Config::get();
+    const Config::Text *icon;
+    if (!probe || canAccess(dir_fd, last.c_str())) { // Check if we have read/write access to pwd
+        if (result.in_home) icon = &config.home; // If we are in our homedir, use the home icon
+        else icon = &config.folder; // If we are outside homedir, use the folder icon
+    }
+    else icon = &config.lock; // If we don't have read/write access, use the lock icon
+    result.icon = *icon;
+    result.len += icon->width;
+
+    if (dir_fd != -1) { close_range(first_fd, dir_fd, 0); }
+
+    return result;
+}
+
+/**
+ * Find the length in bytes of the first character of a string
+ * @param str UTF-8 string
+ * @return Length of the first character, which is at least 1 unless str is empty
+ */
+static size_t charLen(const std::string_view str) {
+    size_t len = std::min<size_t>(1, str.size());
+    while (len < str.size() && (str[len] & 0xc0) == 0x80) { ++len; }
+    return len;
+}
+
+/**
+ * Find the shortest the path can get, the same way addPath() would shrink it
+ */
+size_t Path::minLen(const Context &ctx) {
+    // Without its trailing separator, collect() adds one either way
+    std::string_view pwd = ctx.pwd;
+    if (pwd.ends_with(SEP)) { pwd.remove_suffix(1); }
+    // Same as collect(), with whichever icon is the widest
+    const Config::Image &config = Config::get();
+    size_t len = Width::of(pwd) + 1 + (2 + 2) + std::max({config.home.width, config.folder.width, config.lock.width});
+
+    size_t head = 1;
+    if (const string &home = ctx.home; inDir(pwd, home)) {
+        len -= Width::of(home) - 1;
+        head = home.size() + 1;
+    }
+
+    // Every element but the last is shrunk to its first character
+    for (size_t i = head; i < pwd.length(); ++i) {
         if (pwd[i] == SEP) {
-            path.Append(pwd.substr(head, i - head));
+            const std::string_view name = pwd.substr(head, i - head);
+            len -= Width::of(name) - Width::of(name.substr(0, charLen(name)));
             head = i + 1;
         }
     }
 
-    // minimize the path to the smallest unique string, until we are within max_len. Skip the last element.
-    for (auto i = path.begin(); i.peek() != nullptr; ++i) {
-        if (len > max_len && i.peek()->next != nullptr) len -= minimize(raw_path, *i);
-        display.Append(*i);
+    return len;
+}
+
+/**
+ * Add the path to element. This will attempt to shrink the path to fit within max_len, by first shrinking path
+ * elements to their minimum unique length, and then further shrinking as needed. The last path element will always
+ * be full-size.
+ * @param element Element to add directory information to
+ * @param max_len Length at which to stop minimizing.
+ * @return max_len - the size of the path segment generated, or 0 if the path could not be made to fit.
+ */
+size_t Path::addPath(Element &element, const size_t max_len) const {
+    size_t len = this->len;
+
+    element.addIcon(icon);
+    element.add(" ");
+
+    List<string> display; // What will be displayed
+
+    if (in_home) display.Append("~");
+
+    // Use the minimized path elements until we are within max_len. The last element is never minimized.
+    auto min = small.begin();
+    for (auto i = full.begin(); i != full.end(); ++i, ++min) {
+        if (len > max_len) {
+            len -= Width::of(*i) - Width::of(*min);
+            display.Append(*min);
+        }
+        else display.Append(*i);
     }
 
     // If we still aren't small enough, shrink each path element to one character until we are
     // within max_size, starting from left to right and skipping the last element.
-    for (auto i = display.begin(); i.peek()->next != nullptr; ++i) {
-        auto &s = *i;
-        if (s.length() <= 1 ) continue; // If path element is already only one character, skip it
+    for (size_t i = 0; i + 1 < display.size(); ++i) {
+        auto &s = display[i];
+        const size_t first = charLen(s);
+        if (s.length() <= first) continue; // If path element is already only one character, skip it
         if (len <= max_len) break; // Exit loop when we are within max_len
 
-        len -= s.length() - 1;
-        s = s[0];
+        len -= Width::of(s) - Width::of(std::string_view(s).substr(0, first));
+        s.resize(first);
     }
 
-    if (!in_home) element->add(SEP);
+    if (!in_home) element.add(SEP);
 
-    element->add(display.toString(string{SEP}));
+    if (!display.empty()) element.add(display.toString(string{SEP}));
 
-    return max_len - len;
-}
\ No newline at end of file
+    return len < max_len ? max_len - len : 0;
+}
@@ -1,11 +1,40 @@
 #pragma once
 #include "../Element/Element.h"
+#include "../List/List.h"
 
-class Segment;
+struct Context;
 
+/**
+ * The current working directory, split into its elements. Collecting a path does all of the filesystem work
+ * (the access check and minimizing every element), so fitting it into the remaining space later on is cheap.
+ */
 class Path {
-    [[nodiscard]] static bool canAccess(const char* path);
-    static size_t minimize(string& raw_path, string& path);
+    string icon;
+    bool in_home = false;
+    List<string> full; // Every path element
+    List<string> small; // Every path element, shrunk to its shortest unique prefix
+    size_t len = 0; // Display length of the full-size path
+
+    [[nodiscard]] static bool canAccess(int dir_fd, const char *name);
+    static string minimize(int dir_fd, const string& name);
 public:
-    static size_t addPath(Segment &segment, size_t max_len);
+    static Path collect(const Context &ctx, bool probe = true);
+
+    /**
+     * Find the display length of the path once it is shrunk as far as addPath() goes, without touching the
+     * filesystem. Cheap enough to lay out the prompt with before anything is collected.
+     * @param ctx The shell to render the path for
+     * @return The shortest the path can get, including its icon
+     */
+    static size_t minLen(const Context &ctx);
+
+    /**
+     * Find the length of the shortest prefix of a directory entry that is not shared with any other entry in the
+     * same directory. Unlike minimize(), this always reads the directory.
+     * @param dir_fd Handle on the directory containing the entry. An O_PATH handle will do.
+     * @param name Name of the entry
+     * @return The length of the shortest unique prefix of name, or 0 if the directory could not be read
+     */
+    static size_t shortest(int dir_fd, const string &name);
+    size_t addPath(Element &element, size_t max_len) const;
 };
@@ -0,0 +1,35 @@
+#include "Pool.h"
+
+Pool::Pool(const size_t threads, const size_t limit): limit(limit) {
+    for (size_t i = 0; i < threads; ++i) { workers.emplace_back(&Pool::work, this); }
+}
+
+Pool::~Pool() {
+    {
+        const std::lock_guard guard(lock);
+        stopping = true;
+    }
+    ready.notify_all();
+
+    for (auto &worker : workers) { worker.join(); }
+}
+
+void Pool::work() {
+    while (true) {
+        std::function<void()> job;
+
+        {
+            std::unique_lock guard(lock);
+            ++idle;
+            ready.wait(guard, [this] { return stopping || !jobs.empty(); });
+            --idle;
+            // Finish everything that was queued before shutting down
+            if (jobs.empty()) { return; }
+
+            job = std::move(jobs.front());
+            jobs.pop();
+        }
+
+        job();
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * A small pool of worker threads. Jobs are run in the order they are submitted. A pool can be allowed to grow, for
+ * jobs that can block for good (e.g. on a hung network filesystem), so the jobs queued behind them still get a worker.
+ */
+class Pool {
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> jobs;
+    std::mutex lock;
+    std::condition_variable ready;
+    bool stopping = false;
+    size_t idle = 0; // How many workers are waiting for a job
+    const size_t limit;
+
+    void work();
+public:
+    /**
+     * @param threads How many workers to start with
+     * @param limit How many workers the pool may grow to, when a job is queued and every worker is busy
+     */
+    explicit Pool(size_t threads, size_t limit = 0);
+    ~Pool();
+
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    /**
+     * Queue a job to be run on one of the workers
+     * @param job The job to run
+     * @return A future that holds the return value of job once it has finished
+     */
+    template <typename F>
+    auto submit(F job) -> std::future<std::invoke_result_t<F>> {
+        // std::function needs to be copyable, but packaged_task is not, so it has to live behind a shared_ptr
+        auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::move(job));
+        auto result = task->get_future();
+
+        {
+            const std::lock_guard guard(lock);
+            jobs.emplace([task] { (*task)(); });
+            if (jobs.size() > idle && workers.size() < limit) { workers.emplace_back(&Pool::work, this); }
+        }
+        ready.notify_one();
+
+        return result;
+    }
+};
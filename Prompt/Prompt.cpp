@@ -0,0 +1,767 @@
+#include "Prompt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <semaphore.h>
+
+#include "../config.h"
+#include "../Battery/Battery.h"
+#include "../Buffer/Buffer.h"
+#include "../Config/Config.h"
+#include "../Segment/Segment.h"
+#include "../Sgr/Sgr.h"
+#include "../Element/Element.h"
+#include "../Git/Git.h"
+#include "../term.h"
+#include "../icons.h"
+#include "../Identity/Identity.h"
+#include "../Path/Path.h"
+#include "../Pool/Pool.h"
+#include "../Reader/Reader.h"
+#include "../Sampler/Sampler.h"
+#include "../Saved/Saved.h"
+#include "../Stale/Stale.h"
+#include "../Trace/Trace.h"
+
+// How wide the distro icon is guessed to be before it has ever been looked up
+#define ICON_GUESS 3
+
+// How wide every segment is guessed to be before its collector has ever finished, in the order of Config::Segment.
+// Only used to lay out the prompt, and only for the segments that touch the filesystem.
+static constexpr size_t guesses[Config::SEGMENT_COUNT] = {0, 16, 0, 7, 14, 3, 0, 12};
+
+using steady = std::chrono::steady_clock;
+
+/**
+ * Add an icon from the config, with a space on either side
+ * @param element Element to add to
+ * @param icon The icon
+ */
+static void addPadded(Element &element, const Config::Text &icon) {
+    element.add(' ')->add(icon, icon.width)->add(' ');
+}
+
+/**
+ * Fill an element with the username and hostname
+ * @param element Element to fill
+ * @param ctx The shell to render for
+ * @return true, the element is always used
+ */
+static bool addUserHost(Element &element, const Context &ctx) {
+    const Identity id = Identity::get(ctx);
+    const Config::Image &config = Config::get();
+
+    // If we are root, make the username red
+    if (getuid() == 0) { element.addForm(config.error); }
+    else { element.addForm(config.info); }
+
+    element.add(id.user)->addForm(ctrl::RESET_FG)->add('@');
+
+    // If we are connected over ssh, make the hostname yellow.
+    // If our tty isn't in the utmp file, fall back on checking if the SSH_CONNECTION environment variable is set.
+    // This is less reliable because environment variables are not necessarily preserved in some situations
+    // (e.g. when in sudo or su). However, some situations (e.g. terminal emulators that don't correctly
+    // register themselves to utmp) may result in the current pts not being in the utmp file, requiring the use
+    // of the fallback method.
+    if (id.remote == -1 ? ctx.ssh : id.remote) { element.addForm(config.warn); }
+    else { element.addForm(config.info); }
+    element.add(id.host);
+
+    return true;
+}
+
+/**
+ * Fill an element with the current time
+ * @param element Element to fill
+ * @return true if the time fit in TIME_LEN and the element was filled, false otherwise
+ */
+static bool addTime(Element &element) {
+    char timestr[TIME_LEN] = {};
+    const time_t cur_time = time(nullptr);
+    tm local {};
+    const size_t len = strftime(timestr, TIME_LEN, Config::get().time_format, localtime_r(&cur_time, &local));
+    if (len == 0) { return false; }
+
+    element.add({timestr, len});
+
+    return true;
+}
+
+/**
+ * Color an element by how much of something is left, with the same limits as the battery indicator
+ * @param element Element to color
+ * @param level How much is left, in percent
+ * @param alarm Whether to blink when below the alarm level
+ */
+static void addLevel(Element &element, const int level, const bool alarm = true) {
+    const Config::Image &config = Config::get();
+
+    if      (level <= config.bat_alarm && alarm) element.addForm(ctrl::BLINK)->addForm(config.error);
+    else if (level <= config.bat_warn)           element.addForm(config.error);
+    else if (level <= config.bat_normal)         element.addForm(config.warn);
+    else                                         element.addForm(config.ok);
+}
+
+/**
+ * Fill an element with the current battery level, if a battery is installed
+ * @param element Element to fill
+ * @return true if a battery was found and the element was filled, false otherwise
+ */
+static bool addBat(Element &element) {
+    const auto bat = Battery::collect();
+    if (!bat) { return false; }
+
+    // Blinking is only a warning for when we're about to run out
+    addLevel(element, bat->level, !bat->charging);
+
+    element.add(std::to_string(bat->level) + " ");
+
+    // Battery icons are in steps of 10, so we need to round capacity to the tens place
+    const int pwr_increment = bat->level / 10 + (bat->level % 10 >= 5);
+
+    // Add the icon for whether we are plugged in
+    if (bat->charging) {
+        element.addIcon(bat_charge[pwr_increment]);
+    } else {
+        element.addIcon(bat_drain[pwr_increment]);
+    }
+
+    element.addForm(ctrl::RESET + back::DEFAULT);
+
+    return true;
+}
+
+struct cpu_counters {
+    unsigned long total = 0;
+    unsigned long used = 0;
+};
+
+/**
+ * Connect to the shared memory page holding the previous cpu counters, creating it if it doesn't exist
+ * @return The mapped page
+ */
+static cpu_counters *mapCounters() {
+    // Connect to the shared memory page, and catch the error if it doesn't exist
+    int fd = shm_open(PAGE_NAME, O_RDWR, PAGE_MODE);
+
+    // If our shared page is missing: reset errno, create the shared memory file, and set it's size.
+    // A freshly truncated page is zero-filled, so there is nothing else to initialize.
+    if (fd == -1 && errno == ENOENT) {
+        errno = 0;
+        fd = shm_open(PAGE_NAME, O_CREAT | O_RDWR, PAGE_MODE);
+        ftruncate(fd, sizeof(cpu_counters));
+    }
+
+    // Map the shared page to our struct. The mapping stays valid after the fd is closed.
+    auto *page = static_cast<cpu_counters*>(mmap(nullptr, sizeof(cpu_counters), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    close(fd);
+
+    return page;
+}
+
+/**
+ * Fill an element with the cpu usage since the previous prompt. This utilizes a shared memory page
+ * to share the previous cpu counters with. Only used when no sampler is running.
+ * @param element Element to fill
+ */
+static void addCPUSincePrev(Element &element) {
+    // The page and its lock are opened once and kept for the life of the process
+    static cpu_counters *prev = mapCounters();
+    // Get the lock for the data - if it doesn't exist, create it in an unlocked state
+    static sem_t *lock = sem_open(PAGE_NAME, O_CREAT, PAGE_MODE, 1);
+    // Last computed usage, reused if the counters haven't moved since the previous prompt
+    static unsigned int usage = 0;
+
+    // If the shared memory is currently locked, wait for it to unlock, and then lock it ourselves.
+    sem_wait(lock);
+
+    // Get the first line of /proc/stat. The lines after it are for each core, which we don't need.
+    char buf[256];
+    std::string_view line = Reader::read("/proc/stat", buf, sizeof buf);
+    line = Reader::line(line);
+    // Skip the "cpu" at the start of the line
+    line.remove_prefix(std::min<size_t>(line.size(), 3));
+
+    // user nice system idle iowait irq softirq steal. The guest and guest_nice after them are left out, as guest time
+    // is already counted in user and nice.
+    uint64_t fields[8] {};
+    for (uint64_t &field : fields) { Reader::next(line, field); }
+
+    // Idle and iowait are the two proc counters that indicate idle cpu
+    unsigned long used = fields[0] + fields[1] + fields[2] + fields[5] + fields[6] + fields[7];
+    unsigned long total = fields[3] + fields[4];
+
+    total += used;
+
+    // A warm process can render twice within a single tick, in which case the counters haven't moved
+    if (total != prev->total) { usage = static_cast<int>(100l * (used - prev->used) / (total - prev->total)); }
+
+    prev->total = total;
+    prev->used = used;
+
+    // Release our lock on the shared memory
+    sem_post(lock);
+
+    element.add(std::to_string(usage));
+    addPadded(element, Config::get().cpu);
+}
+
+/**
+ * Fill an element with the current cpu usage. If a sampler is running, this is the usage over the last CPU_WINDOW,
+ * along with the busiest core if it is pegged.
+ * @param element Element to fill
+ * @return true, the element is always used
+ */
+static bool addCPU(Element &element) {
+    const auto load = Sampler::read();
+    if (!load) {
+        addCPUSincePrev(element);
+        return true;
+    }
+
+    const Config::Image &config = Config::get();
+    element.add(std::to_string(load->average));
+
+    // On a box with many cores, a single pegged core barely moves the average
+    if (static_cast<int>(load->hottest) >= config.cpu_hot && load->hottest > load->average) {
+        element.addForm(config.error)->add('/')->add(std::to_string(load->hottest))->addForm(fore::DEFAULT);
+    }
+
+    addPadded(element, config.cpu);
+
+    return true;
+}
+
+/**
+ * Fill an element with how much memory and swap are in use, and how much memory pressure there is. Pressure is only
+ * shown while there is any, and swap is only shown while it is in use.
+ * @param element Element to fill
+ * @return true if the memory usage could be read, false otherwise
+ */
+static bool addMem(Element &element) {
+    // Both files are read at once. The pressure is only two lines.
+    char buf[MEM_BUF], pressure_buf[256];
+    Reader::File files[] = {
+        {"/proc/meminfo", buf, sizeof buf, {}},
+        {"/proc/pressure/memory", pressure_buf, sizeof pressure_buf, {}},
+    };
+    Reader::read(files, std::size(files));
+
+    // Values are in kB
+    const std::string_view meminfo = files[0].text;
+    const uint64_t total = Reader::number(meminfo, "MemTotal:").value_or(0);
+    const uint64_t available = Reader::number(meminfo, "MemAvailable:").value_or(0);
+    const uint64_t swap_total = Reader::number(meminfo, "SwapTotal:").value_or(0);
+    const uint64_t swap_free = Reader::number(meminfo, "SwapFree:").value_or(0);
+
+    if (total == 0) { return false; }
+
+    // Memory that is still available is colored like charge left in a battery
+    const auto left = static_cast<int>(100 * std::min(available, total) / total);
+    addLevel(element, left, false);
+    element.add(std::to_string(100 - left));
+
+    if (swap_total > 0 && swap_free < swap_total) {
+        element.add(" sw")->add(std::to_string(100 * (swap_total - swap_free) / swap_total));
+    }
+
+    // The share of the last 10 seconds that some (or all) tasks were stalled on memory. Missing without CONFIG_PSI.
+    std::string_view pressure = files[1].text;
+    const std::string_view some = Reader::value(Reader::line(pressure), "avg10=", " \n");
+    const std::string_view all = Reader::value(Reader::line(pressure), "avg10=", " \n");
+
+    if (!some.empty() && some != "0.00") {
+        element.add(" psi ")->add(some);
+        if (!all.empty() && all != "0.00") { element.add("/")->add(all); }
+    }
+
+    element.addForm(fore::DEFAULT);
+    addPadded(element, Config::get().mem);
+
+    return true;
+}
+
+/**
+ * Fill an element with information on the current python environment, if in a venv/virtualenv
+ * @param element Element to fill
+ * @param ctx The shell to render for
+ * @return true if a python virtual environment was detected and the element was filled, false otherwise
+ */
+static bool addPythonEnv(Element &element, const Context &ctx) {
+    string name;
+
+    if (ctx.venv_prompt.empty()) {
+        // If VIRTUAL_ENV_PROMPT is empty, try VIRTUAL_ENV
+        // If still empty, assume not using a virtual environment
+        if (ctx.venv.empty()) { return false; }
+        // If using VIRTUAL_ENV, use only the last path segment
+        name = ctx.venv.substr(ctx.venv.find_last_of('/') + 1);
+    } else {
+        // If they exist, clear the parenthesis surrounding the prompt
+        name = ctx.venv_prompt;
+        if (name.starts_with("(")) { name.erase(0, 1); }
+        if (name.ends_with(")")) { name.erase(name.size() - 1, 1); }
+    }
+
+    element.add(name);
+    addPadded(element, Config::get().python);
+    return true;
+}
+
+/**
+ * Fill an element with the state of a git repository
+ * @param element Element to fill
+ * @param git State of the repository
+ * @param checked Whether the work tree was checked. If not, only the branch is known, and it is followed by the
+ * pending marker instead.
+ */
+static void addRepo(Element &element, const Git &git, const bool checked) {
+    const Config::Image &config = Config::get();
+    element.addForm(git.dirty ? config.warn : config.ok)->add(config.branch, config.branch.width)->add(' ');
+    element.add(git.branch);
+    if (!checked) { element.add(config.pending, config.pending.width); }
+    if (git.dirty) { element.add('*'); }
+    if (git.untracked) { element.add('?'); }
+    element.addForm(fore::DEFAULT);
+}
+
+/**
+ * Fill an element with the branch of the git repository we are in, followed by a '*' if any tracked files were
+ * changed, and a '?' if there are untracked files
+ * @param element Element to fill
+ * @param ctx The shell to render for
+ * @return true if we are in a git repository, false otherwise
+ */
+static bool addGit(Element &element, const Context &ctx) {
+    const auto git = Git::collect(ctx.pwd);
+    if (!git) { return false; }
+
+    addRepo(element, *git, true);
+    return true;
+}
+
+/**
+ * Fill an element with only the branch of the git repository we are in, for while the work tree is still being
+ * checked
+ * @param element Element to fill
+ * @param ctx The shell to render for
+ * @return true if we are in a git repository, false otherwise
+ */
+static bool addBranch(Element &element, const Context &ctx) {
+    const auto git = Git::head(ctx.pwd);
+    if (!git) { return false; }
+
+    addRepo(element, *git, false);
+    return true;
+}
+
+/**
+ * Fill an element with the nerd font icon for the current distro.
+ * If we can't find a match, default to the linux "tux" icon.
+ * @param element Element to fill
+ * @param ctx The shell to render for
+ * @return true, the element is always used
+ */
+static bool getIcon(Element &element, const Context &ctx) {
+    const string icon = Identity::get(ctx).icon;
+
+    // Default to the linux penguin ("tux") if we don't know the icon
+    if (icon.empty()) { element.add(icons.find("tux")); }
+    else { element.add(icon); }
+
+    return true;
+}
+
+/**
+ * Fill an element with the exit codes of the last command, if any of them indicate an error
+ * @param element Element to fill
+ * @param ctx The shell to render for
+ * @return true if the last command succeeded, false if it failed and the element was filled
+ */
+static bool statusOK(Element &element, const Context &ctx) {
+    if (ctx.status.empty()) { return true; }
+
+    bool ok = true;
+    string err;
+
+    // Loop through all exit codes
+    for (size_t arg = 0; arg < ctx.status.size(); arg++) {
+        // Check if any character in the exit code is not 0 - this indicates an error
+        for (const char chr : ctx.status[arg]) { if (chr != '0') ok = false; }
+
+        // Add error code to the error string. Add '|' characters between every error.
+        err += ctx.status[arg];
+        if (arg < ctx.status.size() - 1) err += '|';
+    }
+
+    if (!ok) element.addForm(Config::get().error)->add(err);
+    return ok;
+}
+
+/**
+ * Fill the gap between the left and the right segments, the way the config asks for. A sequence is only used if it
+ * comes out shorter than the fill itself.
+ * @param out Buffer to add the fill to
+ * @param config Settings, for the fill and how to draw it
+ * @param count Width of the gap, in columns
+ * @param column Column the right segments start at, counting from 0
+ */
+static void addFill(Buffer &out, const Config::Image &config, const size_t count, const size_t column) {
+    const std::string_view fill = config.fill;
+    char seq[sizeof config.fill.data + 16];
+    int len = -1;
+
+    // REP repeats the last character printed, so the fill is printed once before it
+    if (config.fill_mode == Config::FILL_REPEAT && count > 1) {
+        len = snprintf(seq, sizeof seq, "%.*s\033[%zub", static_cast<int>(fill.size()), fill.data(), count - 1);
+    } else if (config.fill_mode == Config::FILL_MOVE && count > 0) {
+        len = snprintf(seq, sizeof seq, "\033[%zuG", column + 1);
+    }
+
+    if (len > 0 && static_cast<size_t>(len) < sizeof seq && static_cast<size_t>(len) < fill.size() * count) {
+        out.add({seq, static_cast<size_t>(len)});
+    } else {
+        out.repeat(fill, count);
+    }
+}
+
+/**
+ * Get the worker pool the collectors run on. It is created on first use and kept for the life of the process,
+ * so a daemon only starts its workers once.
+ * @return The worker pool
+ */
+static Pool &pool() {
+    static Pool workers(POOL_SIZE);
+    return workers;
+}
+
+/**
+ * Get the worker pool the collectors that walk the filesystem run on. It grows when every worker is stuck, up to
+ * FS_POOL_LIMIT.
+ * @return The worker pool
+ */
+static Pool &fsPool() {
+    static Pool workers(FS_POOL_SIZE, FS_POOL_LIMIT);
+    return workers;
+}
+
+/**
+ * Get the last known values of every collector that produces a T
+ * @return The last known values
+ */
+template <typename T>
+static Stale<T> &stale() {
+    static Stale<T> values;
+    return values;
+}
+
+/**
+ * Start a collector on the worker pool. If the same collector is still running from an earlier prompt,
+ * it is not started again, and the one that is running is waited on instead. Elements are also saved for the
+ * prompts rendered by other processes.
+ * @param key Identifies the collector, and whatever it is collecting for (e.g. the cwd)
+ * @param fn The collector. It must not reference anything owned by the caller, as it may outlive the caller.
+ * @param workers The pool to run it on
+ * @return A future holding the collected value
+ */
+template <typename F, typename T = std::invoke_result_t<F>>
+static std::shared_future<T> start(const string &key, F fn, Pool &workers = pool()) {
+    return stale<T>().start(key, [&key, &fn, &workers] {
+        return workers.submit([key, fn] {
+            try {
+                // Timed by what it collects, not what it collects it for
+                Trace::Span span{std::string_view{key}.substr(0, key.find(':'))};
+                T value = fn();
+                span.stop();
+                if constexpr (std::is_same_v<T, std::optional<Element>>) { Saved::put(key, value); }
+                stale<T>().finish(key, value);
+                return value;
+            } catch (...) {
+                stale<T>().finish(key, {});
+                throw;
+            }
+        }).share();
+    });
+}
+
+/**
+ * Wait for a collector until the deadline. If it doesn't make it, it is left running in the background,
+ * and its last known value is used instead.
+ * @param future The collector, as returned by start()
+ * @param key The key the collector was started with
+ * @param deadline When to stop waiting
+ * @param placeholder Used if the collector misses the deadline and has never finished before
+ * @param fresh If given, cleared if the collector missed the deadline
+ * @return The collected value, the last known value, or placeholder
+ */
+template <typename T>
+static T await(const std::shared_future<T> &future, const string &key, const steady::time_point deadline,
+               T placeholder, bool *fresh = nullptr) {
+    if (future.wait_until(deadline) == std::future_status::ready) { return future.get(); }
+    if (fresh) { *fresh = false; }
+    if (auto value = stale<T>().get(key)) { return *value; }
+    // This process may never have run the collector, but another one may have
+    if constexpr (std::is_same_v<T, std::optional<Element>>) {
+        if (T saved; Saved::get(key, saved)) { return saved; }
+    }
+    return placeholder;
+}
+
+/**
+ * Guess how wide a collector's element will be without running it, for laying out the prompt
+ * @param key The key the collector is started with
+ * @param fallback Used if the collector has never finished, here or in another process
+ * @return The width of the last element the collector produced, or 0 if it didn't produce one
+ */
+static size_t estimate(const string &key, const size_t fallback) {
+    if (const auto value = stale<std::optional<Element>>().get(key)) { return *value ? (*value)->getLen() : 0; }
+    if (std::optional<Element> saved; Saved::get(key, saved)) { return saved ? saved->getLen() : 0; }
+    return fallback;
+}
+
+/**
+ * Run an element collector
+ * @param fn The collector. It is given an empty element, and returns whether the element should be used.
+ * @return The filled element, or nothing if the collector did not produce an element
+ */
+template <typename F>
+static std::optional<Element> fill(F fn) {
+    Element element;
+    if (!fn(element)) { return {}; }
+    return element;
+}
+
+bool Prompt::collect(const std::string_view name, const Context &ctx, Element &element) {
+    if (name == "user_host") { return addUserHost(element, ctx); }
+    if (name == "time") { return addTime(element); }
+    if (name == "cpu") { return addCPU(element); }
+    if (name == "mem") { return addMem(element); }
+    if (name == "bat") { return addBat(element); }
+    if (name == "python") { return addPythonEnv(element, ctx); }
+    if (name == "icon") { return getIcon(element, ctx); }
+    if (name == "status") { return !statusOK(element, ctx); }
+    if (name == "git") { return addGit(element, ctx); }
+    return false;
+}
+
+/**
+ * Find the end of an escape sequence
+ * @param text Text the sequence is in
+ * @param pos Where the sequence starts, at its escape
+ * @return Where the sequence ends, just past its final byte
+ */
+static size_t escapeEnd(const std::string_view text, size_t pos) {
+    if (++pos == text.size()) { return pos; }
+    if (text[pos++] != '[') { return pos; }
+    while (pos < text.size() && (text[pos] < 0x40 || text[pos] > 0x7e)) { ++pos; }
+    return std::min(pos + 1, text.size());
+}
+
+/**
+ * Quote a rendered prompt for the shell that shows it. Every run of escape sequences is marked as taking up no columns
+ * (%{ %} for zsh, \001 \002 for readline), or the shell counts their bytes as columns and puts the cursor that far
+ * off while the line is edited. zsh also expands % in the prompt, so it is doubled.
+ * @param out Buffer the prompt was rendered to
+ * @param begin Where the prompt starts in out
+ * @param shell The shell the prompt is for
+ */
+static void quote(Buffer &out, const size_t begin, const Context::Shell shell) {
+    if (shell == Context::Shell::Other) { return; }
+    const bool zsh = shell == Context::Shell::Zsh;
+    const std::string_view start = zsh ? "%{" : "\001";
+    const std::string_view stop = zsh ? "%}" : "\002";
+
+    // Work out how much longer the prompt gets, so it can be quoted in place
+    std::string_view text{out.data() + begin, out.size() - begin};
+    size_t extra = 0;
+    for (size_t pos = 0; pos < text.size();) {
+        if (text[pos] == '\033') {
+            extra += start.size() + stop.size();
+            while (pos < text.size() && text[pos] == '\033') { pos = escapeEnd(text, pos); }
+        } else {
+            extra += zsh && text[pos] == '%';
+            ++pos;
+        }
+    }
+    if (extra == 0) { return; }
+    // A prompt this long is broken anyways, leave it as it is
+    if (!out.grow(extra)) { return; }
+
+    // Move the prompt to the end, then quote it back to the front. The quoted prompt never catches up with what is
+    // left of the original.
+    char *data = out.data() + begin;
+    memmove(data + extra, data, text.size());
+    text = {data + extra, text.size()};
+    size_t written = 0;
+    const auto put = [&](const std::string_view str) {
+        memmove(data + written, str.data(), str.size());
+        written += str.size();
+    };
+
+    for (size_t pos = 0; pos < text.size();) {
+        if (text[pos] == '\033') {
+            const size_t run = pos;
+            while (pos < text.size() && text[pos] == '\033') { pos = escapeEnd(text, pos); }
+            put(start);
+            put(text.substr(run, pos - run));
+            put(stop);
+        } else {
+            if (zsh && text[pos] == '%') { put("%"); }
+            put(text.substr(pos++, 1));
+        }
+    }
+}
+
+bool Prompt::render(const Context &ctx, Buffer &out) {
+    const Trace::Span span{"render"};
+    // Picks up any change to the config file
+    const Config::Image &config = Config::load();
+    const size_t begin = out.size();
+
+    Segment left{config.left_sep, config.left_sep.width};
+    Segment right{config.right_sep, config.right_sep.width};
+
+    bool shown[Config::SEGMENT_COUNT] {};
+    for (uint8_t i = 0; i < config.right_count; ++i) { shown[config.right[i]] = true; }
+
+    // Every collector that has to wait on the filesystem gets SEGMENT_TIMEOUT to finish. They all run at once,
+    // so this is also about the longest a prompt can take.
+    const auto deadline = steady::now() + std::chrono::milliseconds(SEGMENT_TIMEOUT);
+    // The git status can take a lot longer than that in a large repository, so it only gets as long as the phase
+    // allows. The first phase of an async prompt doesn't wait for it at all, it only gets to finish while the
+    // other collectors are being waited on.
+    const auto slow = ctx.phase == Context::Phase::First ? steady::now()
+                      : ctx.phase == Context::Phase::Refresh ? steady::now() + std::chrono::milliseconds(ASYNC_TIMEOUT)
+                      : deadline;
+    // Collectors that miss their deadline outlive this call, so they get their own copy of the context
+    const auto shared = std::make_shared<const Context>(ctx);
+
+    // The status also colors the prompt character, so it is always needed. It and the other segments that don't
+    // touch the filesystem are filled right away, so their width is known before the layout.
+    const auto failed = fill([&ctx](Element &element) { return !statusOK(element, ctx); });
+    const auto time = shown[Config::TIME] ? fill(addTime) : std::nullopt;
+    const auto python = shown[Config::PYTHON]
+                        ? fill([&ctx](Element &element) { return addPythonEnv(element, ctx); }) : std::nullopt;
+
+    const string user_key = "user_host:" + ctx.tty;
+    const string path_key = "path:" + ctx.pwd;
+    const string git_key = "git:" + ctx.pwd;
+    const string branch_key = "branch:" + ctx.pwd;
+
+    // Decide which segments fit before starting any collector, so the ones that would be cut anyway never run. The
+    // path gets first claim on the line, as much as it needs when shrunk as far as it goes. The segments on the
+    // right then get what is left, by priority. Collectors that do touch the filesystem are assumed to be as wide as
+    // the last element they produced.
+    size_t widths[Config::SEGMENT_COUNT] {};
+    widths[Config::STATUS] = failed ? failed->getLen() : 0;
+    widths[Config::TIME] = time ? time->getLen() : 0;
+    widths[Config::PYTHON] = python ? python->getLen() : 0;
+    widths[Config::USER_HOST] = estimate(user_key, guesses[Config::USER_HOST]);
+    widths[Config::CPU] = estimate("cpu", guesses[Config::CPU]);
+    widths[Config::MEM] = estimate("mem", guesses[Config::MEM]);
+    widths[Config::BAT] = estimate("bat", guesses[Config::BAT]);
+    widths[Config::GIT] = estimate(git_key, guesses[Config::GIT]);
+
+    const size_t left_len = left.getLen(estimate("icon", ICON_GUESS) + Path::minLen(ctx), 2);
+    size_t right_width = 0, right_count = 0;
+    for (const uint8_t segment : config.priority) {
+        if (!shown[segment]) { continue; }
+        const size_t width = widths[segment];
+        // Anything fits if we don't know the width of the terminal
+        if (ctx.width && width && left_len + right.getLen(right_width + width, right_count + 1) > ctx.width) {
+            shown[segment] = false;
+            continue;
+        }
+        right_width += width;
+        right_count += width != 0;
+    }
+
+    // Start every collector that is shown at once. None of them depend on each other, so this takes about as long as
+    // the slowest one. The path does all of its filesystem work here too, only fitting it to the width has to wait.
+    std::shared_future<std::optional<Element>> user_host, cpu, mem, bat, git, branch;
+    if (shown[Config::USER_HOST]) {
+        user_host = start(user_key, [shared] {
+            return fill([&](Element &element) { return addUserHost(element, *shared); });
+        });
+    }
+    if (shown[Config::CPU]) { cpu = start("cpu", [] { return fill(addCPU); }); }
+    if (shown[Config::MEM]) { mem = start("mem", [] { return fill(addMem); }); }
+    if (shown[Config::BAT]) { bat = start("bat", [] { return fill(addBat); }); }
+    if (shown[Config::GIT]) {
+        git = start(git_key, [shared] {
+            return fill([&](Element &element) { return addGit(element, *shared); });
+        }, fsPool());
+        // Only the branch, in case the status doesn't make it and was never collected before
+        branch = start(branch_key, [shared] {
+            return fill([&](Element &element) { return addBranch(element, *shared); });
+        }, fsPool());
+    }
+    auto icon = start("icon", [shared] {
+        return fill([&](Element &element) { return getIcon(element, *shared); });
+    });
+    auto path = start(path_key, [shared] { return Path::collect(*shared); }, fsPool());
+
+    Element pending;
+    pending.add(config.pending, config.pending.width);
+
+    // Whether every value is fresh, or rendering again later would show something new
+    bool complete = true;
+
+    // Assemble the segments in the configured order, no matter which collector finished first
+    Trace::Span wait{"wait"};
+    for (uint8_t i = 0; i < config.right_count; ++i) {
+        if (!shown[config.right[i]]) { continue; }
+        std::optional<Element> element;
+        switch (config.right[i]) {
+            case Config::STATUS: element = failed; break;
+            case Config::USER_HOST: element = await(user_host, user_key, deadline, std::optional{pending}); break;
+            case Config::TIME: element = time; break;
+            case Config::CPU: element = await(cpu, "cpu", deadline, std::optional{pending}); break;
+            case Config::MEM: element = await(mem, "mem", deadline, std::optional{pending}); break;
+            case Config::BAT: element = await(bat, "bat", deadline, std::optional{pending}); break;
+            case Config::PYTHON: element = python; break;
+            case Config::GIT:
+                element = await(git, git_key, slow, await(branch, branch_key, deadline, std::optional{pending}),
+                                &complete);
+                break;
+            default: break;
+        }
+        if (element) right.Append(*element);
+    }
+
+    if (const auto element = await(icon, "icon", deadline, std::optional{pending})) left.Append(*element);
+    wait.stop();
+
+    const Trace::Span layout{"layout"};
+
+    const size_t term_size = ctx.width;
+    const size_t used = left.getLen() + right.getLen();
+    // If we don't know the width of the terminal, don't limit the path at all. If the other segments already take
+    // up the whole line, shrink it as far as it goes.
+    size_t remain = !term_size ? INT_MAX : term_size > used ? term_size - used : 0;
+
+    // If the path can't be collected in time, show it without minimizing it
+    Element *element = left.Append();
+    remain = await(path, path_key, deadline, Path::collect(ctx, false)).addPath(*element, remain);
+
+    left.render(out);
+
+    if (term_size) { addFill(out, config, remain, term_size - right.getLen()); }
+
+    right.render(out);
+    out.add('\n')->add(failed ? config.error : config.ok)->add(config.prompt)->add(ctrl::RESET)->add(' ');
+
+    // Every piece of the prompt sets the colors it needs, most of which are already set
+    out.truncate(begin + Sgr::compact(out.data() + begin, out.size() - begin));
+    quote(out, begin, ctx.shell);
+
+    return complete;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "../Context/Context.h"
+
+using std::string;
+
+class Buffer;
+class Element;
+
+class Prompt {
+public:
+    /**
+     * Render a full prompt. Anything that stays the same between prompts (the distro icon, the battery location,
+     * the cpu counter page, ...) is only looked up on the first call, so a long-running process should reuse this.
+     * @param ctx The shell to render the prompt for
+     * @param out Buffer to render the prompt into, ready to be written to the terminal
+     * @return false if a slow collector didn't finish in time (see Context::Phase), so rendering again later would
+     * show something new
+     */
+    static bool render(const Context &ctx, Buffer &out);
+
+    /**
+     * Run a single collector on the calling thread. Unlike render, there is no deadline, and nothing to fall back on
+     * if the collector fails. Meant for the benchmarks.
+     * @param name Name of the collector: user_host, time, cpu, mem, bat, python, icon, status or git
+     * @param ctx The shell to collect for
+     * @param element Element to fill
+     * @return false if the collector didn't produce an element, or there is no collector by that name
+     */
+    static bool collect(std::string_view name, const Context &ctx, Element &element);
+};
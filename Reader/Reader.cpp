@@ -0,0 +1,94 @@
+#include "Reader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../config.h"
+#include "../Ring/Ring.h"
+#include "../Root/Root.h"
+
+// How many files are handed to io_uring at once
+#define READ_BATCH 8
+
+std::string_view Reader::read(const char *path, char *buf, const size_t size) {
+    return read(Root::open(path, O_RDONLY | O_CLOEXEC), buf, size);
+}
+
+std::string_view Reader::read(const int fd, char *buf, const size_t size) {
+    if (fd == -1) { return {}; }
+
+    const ssize_t got = ::read(fd, buf, size);
+    close(fd);
+
+    return {buf, got > 0 ? static_cast<size_t>(got) : 0};
+}
+
+void Reader::read(File *files, const size_t count) {
+    size_t start = 0;
+
+    if constexpr (READ_URING) {
+        for (; start < count; start += READ_BATCH) {
+            const size_t batch = std::min<size_t>(count - start, READ_BATCH);
+
+            Ring::Read reads[READ_BATCH];
+            for (size_t i = 0; i < batch; ++i) {
+                const File &file = files[start + i];
+                reads[i].path = file.path;
+                reads[i].dir_fd = Root::at(reads[i].path);
+                reads[i].buf = file.buf;
+                reads[i].size = file.size;
+            }
+
+            if (!Ring::read(reads, batch)) { break; }
+
+            for (size_t i = 0; i < batch; ++i) {
+                files[start + i].text = {files[start + i].buf, reads[i].result > 0 ? static_cast<size_t>(reads[i].result) : 0};
+            }
+        }
+    }
+
+    // Without io_uring, or for whatever is left if it stopped working
+    for (; start < count; ++start) { files[start].text = read(files[start].path, files[start].buf, files[start].size); }
+}
+
+std::string_view Reader::value(const std::string_view text, const std::string_view key, const std::string_view end) {
+    for (size_t pos = text.find(key); pos != std::string_view::npos; pos = text.find(key, pos + 1)) {
+        // Only match whole keys
+        if (pos != 0 && text[pos - 1] != '\n' && text[pos - 1] != ' ') { continue; }
+
+        size_t start = pos + key.size();
+        while (start < text.size() && text[start] == ' ') { ++start; }
+        const size_t stop = text.find_first_of(end, start);
+
+        return text.substr(start, stop == std::string_view::npos ? stop : stop - start);
+    }
+
+    return {};
+}
+
+std::optional<uint64_t> Reader::number(const std::string_view text, const std::string_view key) {
+    std::string_view found = value(text, key);
+    uint64_t result;
+    if (!next(found, result)) { return {}; }
+    return result;
+}
+
+bool Reader::next(std::string_view &text, uint64_t &out) {
+    size_t start = 0;
+    while (start < text.size() && text[start] == ' ') { ++start; }
+
+    const auto [end, error] = std::from_chars(text.data() + start, text.data() + text.size(), out);
+    if (error != std::errc{}) { return false; }
+
+    text.remove_prefix(end - text.data());
+    return true;
+}
+
+std::string_view Reader::line(std::string_view &text) {
+    const size_t end = text.find('\n');
+    const std::string_view result = text.substr(0, end);
+    text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+    return result;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+/**
+ * Reads the small text files the collectors get their data from (procfs, sysfs and /etc), and picks them apart.
+ * Files are read with a single read into a buffer the caller provides, and nothing here allocates.
+ */
+class Reader {
+public:
+    /**
+     * A file to read along with others, see read(File*, size_t)
+     */
+    struct File {
+        const char *path; // Under the root (see Root)
+        char *buf; // Buffer to read into
+        size_t size; // Size of buf
+        std::string_view text; // Set to what was read, or an empty view if the file could not be read
+    };
+
+    /**
+     * Read a small system file with a single read
+     * @param path File to read, under the root (see Root)
+     * @param buf Buffer to read into
+     * @param size Size of buf
+     * @return What was read, or an empty view if the file could not be read
+     */
+    static std::string_view read(const char *path, char *buf, size_t size);
+
+    /**
+     * Read a small file with a single read
+     * @param fd fd of the file, which is closed afterwards. May be -1, for a file that could not be opened.
+     * @param buf Buffer to read into
+     * @param size Size of buf
+     * @return What was read, or an empty view if the file could not be read
+     */
+    static std::string_view read(int fd, char *buf, size_t size);
+
+    /**
+     * Read several small system files at once, each with a single read. With READ_URING, they are all read through
+     * io_uring with a single syscall, unless the kernel doesn't allow it. Otherwise they are read one at a time.
+     * @param files Files to read. The text of each is set.
+     * @param count How many files are in files
+     */
+    static void read(File *files, size_t count);
+
+    /**
+     * Find a value in a list of "key=value" or "key: value" pairs. Keys must start a line, or follow a space.
+     * @param text Text to search
+     * @param key Key to look for, including the '=' or ':' after it
+     * @param end Characters that end the value
+     * @return The value, without any leading spaces, or an empty view if the key is missing
+     */
+    static std::string_view value(std::string_view text, std::string_view key, std::string_view end = "\n");
+
+    /**
+     * Find a number in a list of "key=value" or "key: value" pairs. Anything after the number (e.g. a unit) is ignored.
+     * @return The number, or nothing if the key is missing or its value doesn't start with a number
+     */
+    static std::optional<uint64_t> number(std::string_view text, std::string_view key);
+
+    /**
+     * Take the next number off a list of numbers separated by spaces
+     * @param text Text to take the number from. Moved past the number.
+     * @param out Set to the number
+     * @return false if text doesn't start with a number, after any spaces
+     */
+    static bool next(std::string_view &text, uint64_t &out);
+
+    /**
+     * Take the next line off a text
+     * @param text Text to take the line from. Moved past the line and its '\n'.
+     * @return The line, without its '\n'
+     */
+    static std::string_view line(std::string_view &text);
+};
@@ -0,0 +1,202 @@
+#include "Ring.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// How many submissions fit in a ring. Every file takes three (open, read and close).
+#define RING_ENTRIES 64
+// How many files are read at once. Larger batches are split up.
+#define RING_FILES (RING_ENTRIES / 3)
+
+namespace {
+
+/**
+ * The ring of a single thread, mapped from the kernel
+ */
+struct Queue {
+    int fd = -1;
+    bool tried = false; // Whether setting up the ring was already tried, whether or not it worked
+
+    void *sq_ring = MAP_FAILED;
+    void *cq_ring = MAP_FAILED;
+    size_t sq_size = 0;
+    size_t cq_size = 0;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_size = 0;
+
+    unsigned *sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned *sq_array = nullptr;
+    unsigned *cq_head = nullptr;
+    unsigned *cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe *cqes = nullptr;
+
+    ~Queue() { reset(); }
+
+    /**
+     * Tear down the ring, leaving it unusable
+     */
+    void reset() {
+        if (sqes != MAP_FAILED) { munmap(sqes, sqes_size); }
+        if (cq_ring != MAP_FAILED && cq_ring != sq_ring) { munmap(cq_ring, cq_size); }
+        if (sq_ring != MAP_FAILED) { munmap(sq_ring, sq_size); }
+        if (fd != -1) { close(fd); }
+
+        sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+        cq_ring = sq_ring = MAP_FAILED;
+        fd = -1;
+    }
+
+    /**
+     * Set up the ring, and a table of RING_FILES direct descriptors for the files to be opened into
+     * @return false if io_uring can't be used
+     */
+    bool setup() {
+        io_uring_params params {};
+        fd = static_cast<int>(syscall(SYS_io_uring_setup, RING_ENTRIES, &params));
+        if (fd == -1) { return false; }
+
+        sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        // Newer kernels map both rings at once
+        if (params.features & IORING_FEAT_SINGLE_MMAP) { sq_size = cq_size = std::max(sq_size, cq_size); }
+
+        sq_ring = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq_ring == MAP_FAILED) { return false; }
+        cq_ring = params.features & IORING_FEAT_SINGLE_MMAP ? sq_ring
+                  : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED) { return false; }
+
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                               fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) { return false; }
+
+        auto *sq = static_cast<char*>(sq_ring);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+        auto *cq = static_cast<char*>(cq_ring);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        // Files are opened straight into the ring's own table, so the read can use them without a round trip
+        io_uring_rsrc_register files {};
+        files.nr = RING_FILES;
+        files.flags = IORING_RSRC_REGISTER_SPARSE;
+        return syscall(SYS_io_uring_register, fd, IORING_REGISTER_FILES2, &files, sizeof files) == 0;
+    }
+
+    /**
+     * Add a submission. Nothing is submitted until submit() is called.
+     * @return The submission, zeroed out, to fill in
+     */
+    io_uring_sqe *add(const unsigned index) {
+        const unsigned tail = std::atomic_ref{*sq_tail}.load(std::memory_order_relaxed) + index;
+        io_uring_sqe *sqe = &sqes[tail & sq_mask];
+        *sqe = {};
+        sq_array[tail & sq_mask] = tail & sq_mask;
+        return sqe;
+    }
+
+    /**
+     * Submit every submission that was added, and wait for all of them to complete
+     * @param count How many submissions were added
+     * @return false if they couldn't be submitted
+     */
+    bool submit(const unsigned count) const {
+        std::atomic_ref{*sq_tail}.fetch_add(count, std::memory_order_release);
+
+        unsigned submitted = 0;
+        while (true) {
+            const unsigned ready = std::atomic_ref{*cq_tail}.load(std::memory_order_acquire) - *cq_head;
+            if (submitted == count && ready >= count) { return true; }
+
+            const long got = syscall(SYS_io_uring_enter, fd, count - submitted, count - std::min(ready, count),
+                                     IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (got == -1 && errno != EINTR) { return false; }
+            if (got > 0) { submitted += static_cast<unsigned>(got); }
+        }
+    }
+};
+
+thread_local Queue queue;
+
+}
+
+bool Ring::available() {
+    if (!queue.tried) {
+        queue.tried = true;
+        if (!queue.setup()) { queue.reset(); }
+    }
+    return queue.fd != -1;
+}
+
+bool Ring::read(Read *reads, const size_t count) {
+    if (!available()) { return false; }
+
+    for (size_t start = 0; start < count; start += RING_FILES) {
+        const auto batch = static_cast<unsigned>(std::min<size_t>(count - start, RING_FILES));
+
+        for (unsigned i = 0; i < batch; ++i) {
+            Read &read = reads[start + i];
+            read.result = 0;
+
+            // If the open fails, the read and the close are cancelled along with it
+            io_uring_sqe *open = queue.add(i * 3);
+            open->opcode = IORING_OP_OPENAT;
+            open->fd = read.dir_fd;
+            open->addr = reinterpret_cast<uintptr_t>(read.path);
+            open->open_flags = O_RDONLY;
+            open->file_index = i + 1;
+            open->flags = IOSQE_IO_LINK;
+            open->user_data = i * 3;
+
+            // A read that comes up short of the buffer is the norm, but would cancel a normal link, so the close is
+            // hard linked
+            io_uring_sqe *data = queue.add(i * 3 + 1);
+            data->opcode = IORING_OP_READ;
+            data->fd = static_cast<int>(i);
+            data->addr = reinterpret_cast<uintptr_t>(read.buf);
+            data->len = static_cast<unsigned>(read.size);
+            data->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+            data->user_data = i * 3 + 1;
+
+            io_uring_sqe *done = queue.add(i * 3 + 2);
+            done->opcode = IORING_OP_CLOSE;
+            done->file_index = i + 1;
+            done->user_data = i * 3 + 2;
+        }
+
+        // The ring can't be trusted after a failed submission, so it isn't used again
+        if (!queue.submit(batch * 3)) {
+            queue.reset();
+            return false;
+        }
+
+        // Take every completion off the ring. Only the reads have anything to report.
+        unsigned head = *queue.cq_head;
+        const unsigned tail = std::atomic_ref{*queue.cq_tail}.load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+            const io_uring_cqe &cqe = queue.cqes[head & queue.cq_mask];
+            Read &read = reads[start + cqe.user_data / 3];
+            // If the open failed, that is reported instead of the read it cancelled
+            if (cqe.user_data % 3 == 0 && cqe.res < 0) { read.result = cqe.res; }
+            if (cqe.user_data % 3 == 1 && cqe.res != -ECANCELED) { read.result = cqe.res; }
+        }
+        std::atomic_ref{*queue.cq_head}.store(head, std::memory_order_release);
+    }
+
+    return true;
+}
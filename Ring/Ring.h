@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <sys/types.h>
+
+/**
+ * Reads a batch of small files through io_uring. Every file is opened, read and closed by the kernel, and the whole
+ * batch is submitted and waited on with a single syscall, instead of three syscalls a file.
+ *
+ * Each thread gets its own ring, set up the first time it reads a batch and kept for the life of the thread. Kernels
+ * without io_uring, or where it is turned off (e.g. by seccomp in a container), are found out on that first batch, and
+ * every batch after it is turned down, so the caller can fall back on plain syscalls.
+ */
+class Ring {
+public:
+    /**
+     * A file to read
+     */
+    struct Read {
+        int dir_fd; // Directory path is relative to, or AT_FDCWD
+        const char *path;
+        char *buf; // Buffer to read into
+        size_t size; // Size of buf
+        ssize_t result; // Set to how much was read, or to a negative errno
+    };
+
+    /**
+     * Check whether io_uring can be used on this thread, setting up the ring if it wasn't already
+     */
+    static bool available();
+
+    /**
+     * Open, read and close a batch of files. Every file is read with a single read from its start.
+     * @param reads The files to read. The result of each is set, even if the file couldn't be opened.
+     * @param count How many files are in reads
+     * @return false if io_uring can't be used, in which case the files have to be read some other way
+     */
+    static bool read(Read *reads, size_t count);
+};
@@ -0,0 +1,51 @@
+#include "Root.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+int Root::dir_fd = -1;
+string Root::dir;
+
+bool Root::set(const string &path) {
+    if (dir_fd != -1) { close(dir_fd); }
+    dir_fd = -1;
+    dir.clear();
+
+    if (path.empty()) { return true; }
+
+    dir_fd = ::open(path.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd == -1) { return false; }
+    dir = path;
+    return true;
+}
+
+// Paths are absolute, so skipping the leading '/' makes them relative to the root
+
+int Root::open(const char *path, const int flags) {
+    if (dir_fd == -1) { return ::open(path, flags); }
+    return openat(dir_fd, path + 1, flags);
+}
+
+int Root::stat(const char *path, struct stat &info) {
+    if (dir_fd == -1) { return ::stat(path, &info); }
+    return fstatat(dir_fd, path + 1, &info, 0);
+}
+
+DIR *Root::opendir(const char *path) {
+    if (dir_fd == -1) { return ::opendir(path); }
+
+    const int fd = openat(dir_fd, path + 1, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) { return nullptr; }
+
+    DIR *result = fdopendir(fd);
+    if (result == nullptr) { close(fd); }
+    return result;
+}
+
+int Root::at(const char *&path) {
+    if (dir_fd == -1) { return AT_FDCWD; }
+    ++path;
+    return dir_fd;
+}
+
+string Root::path(const char *path) { return dir + path; }
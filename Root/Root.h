@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <dirent.h>
+#include <sys/stat.h>
+
+using std::string;
+
+/**
+ * Where the system files the collectors read are found (/proc, /sys, /etc and the utmp file). Normally that is /,
+ * but the benchmarks point it at a directory of fixtures instead. Every path given here is absolute, and is looked up
+ * relative to the root. Paths that come from the shell (e.g. the cwd) are never moved.
+ *
+ * The root has to be set before any collector runs, it is not safe to change while prompts are being rendered.
+ */
+class Root {
+    static int dir_fd; // -1 while the root is /
+    static string dir;
+public:
+    /**
+     * Move the root
+     * @param path Directory to use as the root, or an empty string to go back to /
+     * @return false if path could not be opened
+     */
+    static bool set(const string &path);
+
+    static int open(const char *path, int flags);
+
+    static int stat(const char *path, struct stat &info);
+
+    static DIR *opendir(const char *path);
+
+    /**
+     * Get a directory fd and a path relative to it that open the same file as open() would, for the interfaces that
+     * take both (e.g. io_uring)
+     * @param path Path of the file. Moved past its leading '/' if the root was moved.
+     * @return fd of the root, or AT_FDCWD while the root is /
+     */
+    static int at(const char *&path);
+
+    /**
+     * Get the path of a file under the root, for the few interfaces that only take a path (e.g. utmpname)
+     */
+    static string path(const char *path);
+};
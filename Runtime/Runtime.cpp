@@ -0,0 +1,59 @@
+#include "Runtime.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/**
+ * Get the directory in /tmp that is used when $XDG_RUNTIME_DIR is unset. Anyone can create files in /tmp, so the
+ * directory has to be one we made: a real directory, owned by us, that nobody else can get into. It is created and
+ * checked once per process.
+ * @return Path of the directory, or an empty string if it isn't safe to use
+ */
+static const string &fallback() {
+    static const string dir = [] () -> string {
+        const string path = "/tmp/promptly." + std::to_string(getuid());
+        mkdir(path.c_str(), 0700);
+
+        struct stat info {};
+        if (lstat(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode) || info.st_uid != getuid()
+            || (info.st_mode & 077) != 0) {
+            fprintf(stderr, "promptly: %s is not a private directory of ours, it is not used\n", path.c_str());
+            return {};
+        }
+
+        return path;
+    }();
+
+    return dir;
+}
+
+string Runtime::dir() {
+    // Prefer the per-user runtime dir. It is only accessible by us, and is cleaned up on logout.
+    if (const char *dir = getenv("XDG_RUNTIME_DIR"); dir != nullptr && *dir) { return dir; }
+    return fallback();
+}
+
+string Runtime::path(const string &name) {
+    const string base = dir();
+    if (base.empty()) { return {}; }
+    return base + "/" + name;
+}
+
+int Runtime::open(const string &name, const int flags) {
+    const string file = path(name);
+    if (file.empty()) { return -1; }
+
+    const int fd = ::open(file.c_str(), flags | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd == -1) { return -1; }
+
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_uid != getuid()) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+using std::string;
+
+class Runtime {
+public:
+    /**
+     * Get the per-user runtime dir. Uses $XDG_RUNTIME_DIR, and falls back on a directory of our own in /tmp
+     * (/tmp/promptly.<uid>) if $XDG_RUNTIME_DIR is unset.
+     * @return Path of the directory, or an empty string if the directory in /tmp isn't safe to use
+     */
+    static string dir();
+
+    /**
+     * Get the path of a file in the per-user runtime dir (see dir())
+     * @param name Name of the file
+     * @return The full path of the file, or an empty string if the directory in /tmp isn't safe to use
+     */
+    static string path(const string &name);
+
+    /**
+     * Open a file in the runtime dir. Symlinks are never followed, and a file that isn't ours is turned down, so nobody
+     * can get us to write to one of their files, or have us read one they filled in.
+     * @param name Name of the file
+     * @param flags Flags for open(). O_NOFOLLOW and O_CLOEXEC are always added, and a file that is created is only
+     * accessible by us.
+     * @return The fd, or -1 if the file could not be opened, or isn't a regular file of ours
+     */
+    static int open(const string &name, int flags);
+};
@@ -0,0 +1,261 @@
+#include "Sampler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../config.h"
+#include "../Reader/Reader.h"
+#include "../Root/Root.h"
+
+// Identifies a page in the current layout. Change this whenever Slot or Page changes.
+#define CPU_MAGIC 0x63707531
+// Largest /proc/stat we will read. Each core's line is well under 128 bytes, and the lines after them are skipped.
+#define STAT_BUF (CPU_MAX_CORES * 128 + 4096)
+
+// The window has to fit in the ring, with one slot to spare for the sample that is being written
+static_assert(CPU_WINDOW / CPU_INTERVAL + 2 <= CPU_RING, "CPU_RING is too small to hold CPU_WINDOW");
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free);
+
+struct Slot {
+    std::atomic<uint32_t> seq; // Odd while the slot is being written
+    uint32_t cores;
+    int64_t time; // CLOCK_MONOTONIC when the sample was taken, in ns
+    // Index 0 is every core together, index n + 1 is core n
+    uint64_t busy[CPU_MAX_CORES + 1];
+    uint64_t total[CPU_MAX_CORES + 1];
+};
+
+struct Page {
+    uint32_t magic;
+    uint32_t slots;
+    std::atomic<uint64_t> count; // How many samples have been taken. The newest is in ring[(count - 1) % CPU_RING].
+    Slot ring[CPU_RING];
+};
+
+// A copy of a slot, taken without tearing
+struct Snapshot {
+    uint32_t cores;
+    int64_t time;
+    uint64_t busy[CPU_MAX_CORES + 1];
+    uint64_t total[CPU_MAX_CORES + 1];
+};
+
+/**
+ * Get the name of the shared page. The page is per-user.
+ */
+static std::string pageName() { return CPU_PAGE_NAME "." + std::to_string(getuid()); }
+
+static int64_t now() {
+    timespec time {};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1'000'000'000l + time.tv_nsec;
+}
+
+/**
+ * Parse the cpu lines at the start of /proc/stat into a slot
+ * @param text Contents of /proc/stat
+ * @param slot Slot to fill
+ */
+static void parse(std::string_view text, Slot &slot) {
+    slot.cores = 0;
+
+    // Lines look like "cpu  user nice system idle iowait irq softirq steal guest guest_nice", first for every
+    // core together and then for each core ("cpu0 ...").
+    while (text.starts_with("cpu")) {
+        std::string_view line = Reader::line(text);
+        line.remove_prefix(3);
+
+        uint64_t index = 0;
+        if (!line.starts_with(' ') && Reader::next(line, index)) { ++index; }
+
+        uint64_t fields[8] {};
+        for (uint64_t &field : fields) { Reader::next(line, field); }
+
+        if (index <= CPU_MAX_CORES) {
+            // Idle and iowait are the two counters that indicate an idle cpu. Guest time is already counted in
+            // user and nice, so the last two fields are left out.
+            const uint64_t idle = fields[3] + fields[4];
+            slot.busy[index] = fields[0] + fields[1] + fields[2] + fields[5] + fields[6] + fields[7];
+            slot.total[index] = slot.busy[index] + idle;
+            slot.cores = std::max(slot.cores, static_cast<uint32_t>(index));
+        }
+    }
+}
+
+int Sampler::run() {
+    const int fd = shm_open(pageName().c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd == -1) {
+        perror("promptly: sampler: shm_open");
+        return 1;
+    }
+
+    // Only one sampler writes to the page. If another one is running, wait for it to go away.
+    while (flock(fd, LOCK_EX) != 0) {
+        if (errno != EINTR) {
+            perror("promptly: sampler: flock");
+            return 1;
+        }
+    }
+
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || (static_cast<size_t>(info.st_size) < sizeof(Page) && ftruncate(fd, sizeof(Page)) != 0)) {
+        perror("promptly: sampler: ftruncate");
+        return 1;
+    }
+
+    void *mapped = mmap(nullptr, sizeof(Page), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        perror("promptly: sampler: mmap");
+        return 1;
+    }
+    // fd is kept open, as closing it would drop the lock
+    auto *page = static_cast<Page*>(mapped);
+
+    // A new page, or one from an older version - start over
+    if (page->magic != CPU_MAGIC || page->slots != CPU_RING) {
+        memset(mapped, 0, sizeof(Page));
+        page->slots = CPU_RING;
+        page->magic = CPU_MAGIC;
+    }
+
+    const int stat_fd = Root::open("/proc/stat", O_RDONLY | O_CLOEXEC);
+    if (stat_fd == -1) {
+        perror("promptly: sampler: /proc/stat");
+        return 1;
+    }
+
+    static char buf[STAT_BUF];
+    uint64_t count = page->count.load(std::memory_order_relaxed);
+
+    constexpr long interval = CPU_INTERVAL * 1'000'000l;
+    timespec next {};
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (true) {
+        // /proc/stat is regenerated every time it is read from the start, so the fd can be reused
+        if (const ssize_t got = pread(stat_fd, buf, STAT_BUF, 0); got > 0) {
+
+            Slot &slot = page->ring[count % CPU_RING];
+            const uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+
+            slot.seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            slot.time = now();
+            parse({buf, static_cast<size_t>(got)}, slot);
+
+            slot.seq.store(seq + 2, std::memory_order_release);
+            page->count.store(++count, std::memory_order_release);
+        }
+
+        next.tv_nsec += interval;
+        next.tv_sec += next.tv_nsec / 1'000'000'000l;
+        next.tv_nsec %= 1'000'000'000l;
+
+        // If we fell behind (the machine was suspended, or we weren't scheduled), don't try to catch up
+        timespec current {};
+        clock_gettime(CLOCK_MONOTONIC, &current);
+        if (current.tv_sec > next.tv_sec + 1) { next = current; }
+
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+    }
+}
+
+void Sampler::start() { std::thread(run).detach(); }
+
+/**
+ * Map the shared page for reading. The sampler may not have created it yet, so this is retried until it succeeds.
+ * @return The mapped page, or nullptr if there is no page (yet)
+ */
+static const Page *mapPage() {
+    static std::atomic<const Page*> mapped = nullptr;
+    if (const Page *page = mapped.load(std::memory_order_acquire)) { return page; }
+
+    const int fd = shm_open(pageName().c_str(), O_RDONLY, 0);
+    if (fd == -1) { return nullptr; }
+
+    struct stat info {};
+    void *page = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(Page)) {
+        page = mmap(nullptr, sizeof(Page), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (page == MAP_FAILED) { return nullptr; }
+
+    // Another thread may have mapped it at the same time, in which case our mapping is dropped
+    const Page *expected = nullptr;
+    if (!mapped.compare_exchange_strong(expected, static_cast<const Page*>(page))) {
+        munmap(page, sizeof(Page));
+        return expected;
+    }
+
+    return static_cast<const Page*>(page);
+}
+
+/**
+ * Copy a slot. If the sampler writes to it while we are copying, the copy is thrown away and taken again.
+ * @param slot Slot to copy
+ * @param out Filled with the copy
+ * @return false if the slot kept changing
+ */
+static bool snapshot(const Slot &slot, Snapshot &out) {
+    for (int tries = 0; tries < 4; ++tries) {
+        const uint32_t before = slot.seq.load(std::memory_order_acquire);
+        if (before & 1) { continue; }
+
+        out.cores = std::min(slot.cores, static_cast<uint32_t>(CPU_MAX_CORES));
+        out.time = slot.time;
+        memcpy(out.busy, slot.busy, sizeof(uint64_t) * (out.cores + 1));
+        memcpy(out.total, slot.total, sizeof(uint64_t) * (out.cores + 1));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == before) { return true; }
+    }
+
+    return false;
+}
+
+/**
+ * Get the usage of a cpu between two samples, in percent
+ */
+static unsigned int usage(const Snapshot &from, const Snapshot &to, const size_t index) {
+    const uint64_t total = to.total[index] - from.total[index];
+    if (total == 0 || to.total[index] < from.total[index]) { return 0; }
+    return static_cast<unsigned int>(100 * (to.busy[index] - from.busy[index]) / total);
+}
+
+std::optional<Sampler::Load> Sampler::read() {
+    const Page *page = mapPage();
+    if (page == nullptr || page->magic != CPU_MAGIC) { return {}; }
+
+    const uint64_t count = page->count.load(std::memory_order_acquire);
+    if (count < 2) { return {}; }
+
+    Snapshot newest, oldest; // NOLINT(*-pro-type-member-init)
+    if (!snapshot(page->ring[(count - 1) % CPU_RING], newest)) { return {}; }
+
+    // A sampler that has stopped leaves its last samples behind
+    if (now() - newest.time > 3 * CPU_INTERVAL * 1'000'000l) { return {}; }
+
+    const uint64_t back = std::min<uint64_t>(count - 1, CPU_WINDOW / CPU_INTERVAL);
+    if (!snapshot(page->ring[(count - 1 - back) % CPU_RING], oldest) || oldest.time >= newest.time) { return {}; }
+
+    Load load {usage(oldest, newest, 0), 0};
+    for (size_t core = 1; core <= std::min(oldest.cores, newest.cores); ++core) {
+        load.hottest = std::max(load.hottest, usage(oldest, newest, core));
+    }
+
+    return load;
+}
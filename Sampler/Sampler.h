@@ -0,0 +1,36 @@
+#pragma once
+
+#include <optional>
+
+/**
+ * Samples /proc/stat in the background, so the cpu usage in a prompt covers a fixed window of time instead of
+ * whatever happened since the last prompt. Every CPU_INTERVAL, the counters for every core are written to a ring
+ * of CPU_RING samples in a shared memory page. Prompts only read the page, and never take a lock: every slot in the
+ * ring is guarded by its own sequence counter, and a reader simply retries if a slot changed while it was reading.
+ *
+ * Only one sampler runs per user. Any others wait on a lock on the page, and take over if the running one exits.
+ */
+class Sampler {
+public:
+    struct Load {
+        unsigned int average; // Usage across every core, in percent
+        unsigned int hottest; // Usage of the busiest core, in percent
+    };
+
+    /**
+     * Sample forever. Only returns if the shared page could not be set up.
+     * @return exit code for the process
+     */
+    static int run();
+
+    /**
+     * Run the sampler on a background thread
+     */
+    static void start();
+
+    /**
+     * Read the cpu usage over the last CPU_WINDOW
+     * @return The usage, or nothing if no sampler is running or it hasn't collected enough samples yet
+     */
+    static std::optional<Load> read();
+};
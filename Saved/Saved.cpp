@@ -0,0 +1,112 @@
+#include "Saved.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../Hash/Hash.h"
+#include "../Runtime/Runtime.h"
+
+// Identifies a saved file in the current layout. Change this whenever Entry or Header changes.
+#define SAVED_MAGIC 0x73617631
+// How many slots to look at for an entry, starting from the one its key hashes to
+#define SAVED_PROBE 4
+
+Saved::Entry *Saved::map() {
+    // Entries are checksummed byte by byte, so there must not be any padding in them
+    static_assert(sizeof(Entry) == offsetof(Entry, content) + SAVED_SIZE, "Saved::Entry has padding");
+
+    // Mapped once, and kept for the life of the process
+    static Entry *entries = [] () -> Entry* {
+        constexpr size_t size = sizeof(Header) + sizeof(Entry) * SAVED_SLOTS;
+
+        const int fd = Runtime::open(SAVED_NAME, O_RDWR | O_CREAT);
+        if (fd == -1) { return nullptr; }
+
+        struct stat info {};
+        if (fstat(fd, &info) != 0 || (static_cast<size_t>(info.st_size) < size && ftruncate(fd, size) != 0)) {
+            close(fd);
+            return nullptr;
+        }
+
+        void *page = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (page == MAP_FAILED) { return nullptr; }
+
+        // A new file, or one from an older version - start over
+        auto *header = static_cast<Header*>(page);
+        if (header->magic != SAVED_MAGIC || header->slots != SAVED_SLOTS) {
+            memset(page, 0, size);
+            header->slots = SAVED_SLOTS;
+            header->magic = SAVED_MAGIC;
+        }
+
+        return reinterpret_cast<Entry*>(header + 1);
+    }();
+
+    return entries;
+}
+
+uint32_t Saved::checksum(const Entry &entry) {
+    // Only the part of the content that is in use is hashed, the rest may hold an older element
+    uint64_t hash = fnv(&entry, offsetof(Entry, check));
+    const size_t used = offsetof(Entry, content) - offsetof(Entry, size) + std::min<size_t>(entry.size, SAVED_SIZE);
+    hash = fnv(&entry.size, used, hash);
+    // A zeroed slot must never look valid
+    return static_cast<uint32_t>(hash ^ hash >> 32) | 1;
+}
+
+bool Saved::get(const string &key, std::optional<Element> &out) {
+    Entry *entries = map();
+    if (entries == nullptr) { return false; }
+
+    const uint64_t hash = fnv(key.data(), key.size());
+
+    for (size_t i = 0, pos = hash % SAVED_SLOTS; i < SAVED_PROBE; ++i, pos = (pos + 1) % SAVED_SLOTS) {
+        if (entries[pos].key != hash) { continue; }
+
+        // Copy the entry out before checking it, another prompt may be writing to it right now
+        Entry entry;
+        memcpy(&entry, &entries[pos], sizeof entry);
+        if (entry.key != hash || entry.size > SAVED_SIZE || entry.check != checksum(entry)) { continue; }
+
+        out.reset();
+        if (entry.present) { out.emplace().add({entry.content, entry.size}, entry.len); }
+        return true;
+    }
+
+    return false;
+}
+
+void Saved::put(const string &key, const std::optional<Element> &element) {
+    if (element && element->getContent().size() > SAVED_SIZE) { return; }
+
+    Entry *entries = map();
+    if (entries == nullptr) { return; }
+
+    Entry entry;
+    entry.key = fnv(key.data(), key.size());
+    entry.len = element ? element->getLen() : 0;
+    entry.size = element ? element->getContent().size() : 0;
+    entry.present = element.has_value();
+    if (element) { memcpy(entry.content, element->getContent().data(), entry.size); }
+    entry.check = checksum(entry);
+
+    // Reuse a slot that already holds this key or is empty. If there is none, evict the first slot.
+    const size_t first = entry.key % SAVED_SLOTS;
+    size_t target = first;
+    for (size_t i = 0, pos = first; i < SAVED_PROBE; ++i, pos = (pos + 1) % SAVED_SLOTS) {
+        const Entry &cur = entries[pos];
+        if (cur.key == entry.key || cur.check == 0) {
+            target = pos;
+            break;
+        }
+    }
+
+    // Only the part of the content that is in use is copied
+    memcpy(&entries[target], &entry, offsetof(Entry, content) + entry.size);
+}
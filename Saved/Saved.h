@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "../config.h"
+#include "../Element/Element.h"
+
+using std::string;
+
+/**
+ * The last element every collector produced, kept in a file mapped from the runtime dir. This is what lets a prompt
+ * rendered by a fresh process fall back on the last known value of a collector that misses its deadline, instead of
+ * a placeholder - the in-memory values in Stale only last as long as the process.
+ */
+class Saved {
+    struct Entry {
+        uint64_t key; // Hash of the collector's key
+        uint32_t len; // Width of the element
+        uint32_t check; // Hash of every other field. Lets us spot entries that were torn by two prompts writing at once.
+        uint16_t size; // Length of the element's content
+        uint8_t present; // Whether the collector produced an element at all
+        char content[SAVED_SIZE];
+    };
+
+    struct Header {
+        uint32_t magic;
+        uint32_t slots;
+    };
+
+    static Entry *map();
+    static uint32_t checksum(const Entry &entry);
+public:
+    /**
+     * Look up the last element a collector produced
+     * @param key Key of the collector
+     * @param out Filled with the element, or with nothing if the collector didn't produce one
+     * @return false if nothing is saved for the collector
+     */
+    static bool get(const string &key, std::optional<Element> &out);
+
+    /**
+     * Save the element a collector produced. Elements longer than SAVED_SIZE are not saved.
+     * @param key Key of the collector
+     * @param element The element, or nothing if the collector didn't produce one
+     */
+    static void put(const string &key, const std::optional<Element> &element);
+};
@@ -1,29 +1,32 @@
 #include "Segment.h"
 
+#include "../Buffer/Buffer.h"
+
 using std::string;
 
-size_t Segment::getLen() const {
-    size_t size = base_len;
+size_t Segment::getLen() const { return getLen(0, 0); }
+
+size_t Segment::getLen(const size_t width, const size_t count) const {
+    size_t size = base_len + width;
 
     for (const auto& i : elements)
-        size += sep_len + i.getLen();
+        size += i.getLen();
 
-    // We hae added the length of sep for every element, but there are one fewer
-    // separators that there are elements, so we need to subtract sep_len once
-    return size - sep_len;
+    // There is a separator between every two elements, and none in a segment without elements. The dividers are
+    // drawn either way.
+    const size_t total = elements.size() + count;
+    return total ? size + sep_len * (total - 1) : size;
 }
 
-string Segment::getContent() const {
-    string s = L_DIV;
-
-    auto begin = elements.begin();
-    const auto end = elements.end();
-
-    s += (*begin).getContent();
-    ++begin;
+void Segment::render(Buffer &out) const {
+    out.add(L_DIV);
 
-    for (auto i = *begin; begin != end; ++begin, i = *begin)
-        s += sep + i.getContent();
+    bool first = true;
+    for (const auto& i : elements) {
+        if (!first) out.add(sep);
+        out.add(i.getContent());
+        first = false;
+    }
 
-    return s + R_DIV;
+    out.add(R_DIV);
 }
@@ -1,9 +1,7 @@
 #pragma once
 
-#define INT_R_DIV ( " " + back::DEFAULT + fore::BG_DEFAULT + ctrl::RESET_BG + "\ue0b0" + fore::DEFAULT )
-#define INT_L_DIV ( ctrl::RESET_BG + fore::BG_DEFAULT + "\ue0b2" + fore::DEFAULT + back::DEFAULT + " " )
-
 #include <string>
+#include <string_view>
 
 #include "../term.h"
 #include "../Element/Element.h"
@@ -11,18 +9,32 @@
 
 using std::string;
 
+class Buffer;
+
 class Segment {
-    // R_DIV and L_DIV can't be constexpr because GCC doesn't like constexpr strings w/ a length over 15 characters
-    inline static const string R_DIV = INT_R_DIV;
-    inline static const string L_DIV = INT_L_DIV;
-    static constexpr size_t base_len = u_strlen(INT_R_DIV) + u_strlen(INT_L_DIV);
+    static constexpr Literal R_DIV = " " + back::DEFAULT + fore::BG_DEFAULT + ctrl::RESET_BG + "\ue0b0" + fore::DEFAULT;
+    static constexpr Literal L_DIV = ctrl::RESET_BG + fore::BG_DEFAULT + "\ue0b2" + fore::DEFAULT + back::DEFAULT + " ";
+    static constexpr size_t base_len = R_DIV.width + L_DIV.width;
 
-    const string sep;
+    const std::string_view sep;
     const size_t sep_len;
 
     List<Element> elements;
 public:
-    Segment(string sep, const size_t len): sep(std::move(sep)), sep_len(len) {}
+    /**
+     * @param sep Separator put between elements. It is not copied, so it has to be a static constant.
+     */
+    template <size_t N>
+    explicit Segment(const Literal<N> &sep): sep(sep), sep_len(sep.width) {}
+
+    template <size_t N>
+    explicit Segment(const Literal<N> &&sep) = delete;
+
+    /**
+     * @param sep Separator put between elements. It is not copied, so it has to outlive the segment.
+     * @param sep_len Display width of sep
+     */
+    Segment(const std::string_view sep, const size_t sep_len): sep(sep), sep_len(sep_len) {}
 
     Element* Append() {
         return elements.Append(Element());
@@ -32,6 +44,22 @@ public:
         return elements.Append(Element(data));
     }
 
+    Element* Append(const Element& element) {
+        return elements.Append(element);
+    }
+
     [[nodiscard]] size_t getLen() const;
-    [[nodiscard]] string getContent() const;
+
+    /**
+     * Get the length the segment would have with more elements added to it
+     * @param width Total display width of the elements that would be added
+     * @param count How many elements would be added
+     */
+    [[nodiscard]] size_t getLen(size_t width, size_t count) const;
+
+    /**
+     * Render the segment and all of its elements
+     * @param out Buffer to render into
+     */
+    void render(Buffer &out) const;
 };
@@ -0,0 +1,283 @@
+#include "Sgr.h"
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Longest color code that is kept, e.g. "38;2;255;255;255"
+#define COLOR_LEN 20
+// Longest sequence that is built for a single transition
+#define SEQ_LEN 128
+
+namespace {
+
+/**
+ * A foreground or background color, as the parameters that set it
+ */
+struct Color {
+    bool known = false;
+    uint8_t len = 0;
+    char code[COLOR_LEN] {};
+
+    [[nodiscard]] std::string_view view() const { return {code, len}; }
+    bool operator==(const Color &other) const { return known == other.known && view() == other.view(); }
+
+    void set(const std::string_view value) {
+        known = true;
+        len = static_cast<uint8_t>(value.size());
+        memcpy(code, value.data(), value.size());
+    }
+};
+
+/**
+ * A style that is turned on with one code and off with another
+ */
+struct Flag {
+    int on;
+    int off;
+};
+
+// Bold and dim share the code that turns them off, as do both kinds of blinking
+constexpr Flag flags[] = {{1, 22}, {2, 22}, {3, 23}, {4, 24}, {5, 25}, {6, 25}, {7, 27}, {8, 28}, {9, 29}};
+constexpr uint16_t ALL_FLAGS = (1 << std::size(flags)) - 1;
+
+/**
+ * The attributes in effect. Attributes the prompt hasn't set yet are unknown, as they are whatever the terminal was
+ * left with.
+ */
+struct State {
+    Color fore;
+    Color back;
+    uint16_t known = 0; // Which flags are known
+    uint16_t set = 0; // Which of the known flags are on
+
+    void reset() {
+        fore.set("39");
+        back.set("49");
+        known = ALL_FLAGS;
+        set = 0;
+    }
+
+    /**
+     * Take a ";n" parameter off the front of a list of parameters
+     * @return false if the list doesn't start with one
+     */
+    static bool next(std::string_view &params, unsigned &out) {
+        if (!params.starts_with(';')) { return false; }
+        const auto [end, error] = std::from_chars(params.data() + 1, params.data() + params.size(), out);
+        if (error != std::errc{}) { return false; }
+        params.remove_prefix(end - params.data());
+        return true;
+    }
+
+    /**
+     * Apply the parameters of a single SGR sequence
+     * @param params The parameters, e.g. "38;5;246"
+     * @return false if there is a parameter that isn't understood
+     */
+    bool apply(std::string_view params) {
+        // "\033[m" is the same as "\033[0m"
+        if (params.empty()) {
+            reset();
+            return true;
+        }
+
+        while (!params.empty()) {
+            const char *begin = params.data();
+
+            // An empty parameter is a 0
+            unsigned code = 0;
+            const auto [end, error] = std::from_chars(params.data(), params.data() + params.size(), code);
+            if (error == std::errc::result_out_of_range) { return false; }
+            params.remove_prefix(end - params.data());
+
+            if (code == 38 || code == 48) {
+                // An extended color: 5;n from the 256 color palette, or 2;r;g;b
+                unsigned kind = 0, value = 0;
+                if (!next(params, kind) || (kind != 5 && kind != 2)) { return false; }
+                for (int i = 0; i < (kind == 5 ? 1 : 3); ++i) {
+                    if (!next(params, value) || value > 255) { return false; }
+                }
+
+                const std::string_view color{begin, static_cast<size_t>(params.data() - begin)};
+                if (color.size() > COLOR_LEN) { return false; }
+                (code == 38 ? fore : back).set(color);
+            } else if (code == 0) {
+                reset();
+            } else if ((code >= 30 && code <= 37) || (code >= 90 && code <= 97) || code == 39) {
+                fore.set({begin, static_cast<size_t>(end - begin)});
+            } else if ((code >= 40 && code <= 47) || (code >= 100 && code <= 107) || code == 49) {
+                back.set({begin, static_cast<size_t>(end - begin)});
+            } else {
+                bool found = false;
+                for (size_t i = 0; i < std::size(flags); ++i) {
+                    if (flags[i].on == static_cast<int>(code)) {
+                        known |= 1 << i;
+                        set |= 1 << i;
+                        found = true;
+                    } else if (flags[i].off == static_cast<int>(code)) {
+                        known |= 1 << i;
+                        set &= ~(1 << i);
+                        found = true;
+                    }
+                }
+                if (!found) { return false; }
+            }
+
+            if (params.empty()) { break; }
+            if (params[0] != ';') { return false; }
+            params.remove_prefix(1);
+        }
+
+        return true;
+    }
+};
+
+/**
+ * Builds a single SGR sequence
+ */
+struct Sequence {
+    char data[SEQ_LEN];
+    size_t len = 0;
+
+    void add(const std::string_view code) {
+        // Leave room for the introducer, the separator and the final 'm'
+        if (len + code.size() + 4 > sizeof data) { return; }
+        if (len == 0) {
+            data[len++] = '\033';
+            data[len++] = '[';
+        } else {
+            data[len++] = ';';
+        }
+        memcpy(data + len, code.data(), code.size());
+        len += code.size();
+    }
+
+    void add(const int code) {
+        char buf[8];
+        const auto [end, error] = std::to_chars(buf, buf + sizeof buf, code);
+        add({buf, static_cast<size_t>(end - buf)});
+    }
+
+    /**
+     * @return The finished sequence, or an empty view if nothing was added
+     */
+    std::string_view finish() {
+        if (len == 0) { return {}; }
+        data[len] = 'm';
+        return {data, len + 1};
+    }
+};
+
+/**
+ * Build the shortest sequence that changes the attributes in effect to the ones wanted
+ * @param from Attributes in effect
+ * @param to Attributes wanted. Only ever knows more than from.
+ * @param seq Filled with the sequence
+ */
+void transition(const State &from, const State &to, Sequence &seq) {
+    // Change only what differs
+    Sequence changes;
+    if (to.fore.known && !(from.fore == to.fore)) { changes.add(to.fore.view()); }
+    if (to.back.known && !(from.back == to.back)) { changes.add(to.back.view()); }
+
+    uint16_t on = to.known & to.set & ~(from.known & from.set);
+    const uint16_t off = to.known & ~to.set & ~(from.known & ~from.set);
+    int last_off = 0;
+    for (size_t i = 0; i < std::size(flags); ++i) {
+        if (!(off & 1 << i) || flags[i].off == last_off) { continue; }
+        changes.add(flags[i].off);
+        last_off = flags[i].off;
+        // The code also turned off the flag it shares with this one, which may have to stay on
+        for (size_t j = 0; j < std::size(flags); ++j) {
+            if (flags[j].off == flags[i].off && to.known & to.set & 1 << j) { on |= 1 << j; }
+        }
+    }
+    for (size_t i = 0; i < std::size(flags); ++i) { if (on & 1 << i) { changes.add(flags[i].on); } }
+
+    seq = changes;
+
+    // Or start over from a reset, if every attribute is known and that comes out shorter
+    if (!to.fore.known || !to.back.known || to.known != ALL_FLAGS) { return; }
+
+    Sequence reset;
+    reset.add("0");
+    if (to.fore.view() != "39") { reset.add(to.fore.view()); }
+    if (to.back.view() != "49") { reset.add(to.back.view()); }
+    for (size_t i = 0; i < std::size(flags); ++i) { if (to.set & 1 << i) { reset.add(flags[i].on); } }
+
+    if (reset.len < changes.len) { seq = reset; }
+}
+
+}
+
+size_t Sgr::compact(char *text, const size_t size) {
+    State current; // Attributes in effect after what was written so far
+    State wanted; // Attributes wanted for the next text
+    size_t out = 0; // Where to write next
+    size_t run = 0; // Start of the sequences that haven't been written yet
+
+    // Write the sequences waiting in [run, end) as a single transition
+    const auto flush = [&](const size_t end) {
+        Sequence seq;
+        transition(current, wanted, seq);
+        std::string_view result = seq.finish();
+
+        // It should always come out shorter, but if it doesn't, the sequences are kept as they were
+        if (result.size() > end - run) { result = {text + run, end - run}; }
+        if (!result.empty()) {
+            memmove(text + out, result.data(), result.size());
+            out += result.size();
+        }
+
+        current = wanted;
+        run = end;
+    };
+
+    size_t pos = 0;
+    while (pos < size) {
+        if (text[pos] != '\033' || pos + 1 >= size || text[pos + 1] != '[') {
+            // Text, or an escape that isn't a CSI sequence
+            if (run != pos) { flush(pos); }
+            text[out++] = text[pos++];
+            run = pos;
+            continue;
+        }
+
+        // Find the end of the CSI sequence: parameters, then intermediates, then the final byte
+        size_t end = pos + 2;
+        while (end < size && (text[end] < 0x40 || text[end] > 0x7e)) { ++end; }
+        if (end == size) {
+            // Cut off, keep it as it is
+            if (run != pos) { flush(pos); }
+            memmove(text + out, text + pos, size - pos);
+            out += size - pos;
+            run = pos = size;
+            break;
+        }
+
+        const std::string_view params{text + pos + 2, end - pos - 2};
+        const bool sgr = text[end] == 'm' && params.find_first_not_of("0123456789;") == std::string_view::npos;
+
+        State next = wanted;
+        if (sgr && next.apply(params)) {
+            // Held back until there is text to apply it to
+            wanted = next;
+            pos = end + 1;
+            continue;
+        }
+
+        // Some other sequence, or attributes we don't track. Write it as it is, after everything before it.
+        if (run != pos) { flush(pos); }
+        memmove(text + out, text + pos, end + 1 - pos);
+        out += end + 1 - pos;
+        pos = end + 1;
+        run = pos;
+        // An SGR sequence we don't understand leaves us not knowing anything
+        if (sgr) { current = wanted = State{}; }
+    }
+
+    if (run != size) { flush(size); }
+    return out;
+}
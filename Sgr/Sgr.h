@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * Shrinks the SGR (color and style) sequences in a rendered prompt. The prompt is put together from pieces that each
+ * set whatever colors they need, so it is full of sequences that set an attribute that is already set, or that is
+ * changed again before any text is printed.
+ *
+ * The attributes are tracked as the prompt is read, and every run of sequences is replaced with a single sequence
+ * that only sets the attributes that differ from what is already in effect, right before the text that needs them.
+ * The state of the terminal before the prompt is unknown, so an attribute the prompt sets is always set the first
+ * time, even if it is set to its default, and an attribute the prompt never sets is never touched.
+ */
+class Sgr {
+public:
+    /**
+     * Rewrite the SGR sequences in some text
+     * @param text Text to rewrite, in place
+     * @param size Size of text
+     * @return The new size of text, which is never larger than size
+     */
+    static size_t compact(char *text, size_t size);
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <future>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+
+using std::string;
+
+// How many values to keep before old ones are thrown out. Keys include things like the cwd, so a
+// long-running daemon would otherwise grow forever.
+#define STALE_MAX 256
+
+/**
+ * The last known value of every collector, for when a collector doesn't finish in time. Also tracks which
+ * collectors are still running, so a collector that is stuck (e.g. on a hung NFS mount) is not started again
+ * for every prompt, and a later prompt can still wait on one that was started by an earlier one.
+ */
+template <typename T>
+class Stale {
+    struct Entry {
+        std::optional<T> value;
+        std::shared_future<T> running; // Valid while the collector is running
+    };
+
+    std::mutex lock;
+    std::map<string, Entry> entries;
+
+public:
+    /**
+     * Start a collector, unless it is already running
+     * @param key Key of the collector
+     * @param launch Starts the collector, and returns a future for its value. The collector must call finish() once
+     * it is done. launch is called with the lock held, so finish() can't run before the future has been stored.
+     * @return A future for the value of the collector, either the one that was just started or the one that was
+     * already running
+     */
+    template <typename F>
+    std::shared_future<T> start(const string &key, F launch) {
+        const std::lock_guard guard(lock);
+
+        if (entries.size() >= STALE_MAX && !entries.contains(key))
+            std::erase_if(entries, [](const auto &entry) { return !entry.second.running.valid(); });
+
+        Entry &entry = entries[key];
+        if (!entry.running.valid()) { entry.running = launch(); }
+        return entry.running;
+    }
+
+    /**
+     * Mark a collector as finished, and store the value it produced
+     * @param key Key of the collector
+     * @param value The value the collector produced. If empty, the last known value is kept.
+     */
+    void finish(const string &key, std::optional<T> value) {
+        const std::lock_guard guard(lock);
+
+        Entry &entry = entries[key];
+        entry.running = {};
+        if (value) { entry.value = std::move(value); }
+    }
+
+    /**
+     * Get the last known value of a collector
+     * @param key Key of the collector
+     * @return The last value the collector produced, or nothing if it never finished
+     */
+    std::optional<T> get(const string &key) {
+        const std::lock_guard guard(lock);
+
+        const auto entry = entries.find(key);
+        if (entry == entries.end()) { return {}; }
+        return entry->second.value;
+    }
+};
@@ -0,0 +1,236 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../config.h"
+#include "../Hash/Hash.h"
+#include "../Runtime/Runtime.h"
+
+// Identifies a stats file in the current layout. Change this whenever Stage or Header changes.
+#define STATS_MAGIC 0x73746131
+// Longest stage name that is kept, including the terminating NUL
+#define STATS_NAME_LEN 24
+
+namespace {
+
+/**
+ * Durations of a single stage, shared by every process
+ */
+struct Stage {
+    std::atomic<uint64_t> key; // Hash of the name, 0 if the slot is free
+    char name[STATS_NAME_LEN];
+    std::atomic<uint64_t> count; // How many durations were ever recorded
+    std::atomic<uint32_t> samples[STATS_PROMPTS]; // The last STATS_PROMPTS durations in microseconds, as a ring
+};
+
+struct Header {
+    uint32_t magic;
+    uint32_t stages;
+};
+
+/**
+ * A span kept for the trace
+ */
+struct Event {
+    string name;
+    int64_t start; // Nanoseconds, on CLOCK_MONOTONIC
+    int64_t duration; // Nanoseconds
+    pid_t tid;
+};
+
+std::atomic<bool> tracing = false;
+std::mutex events_lock;
+std::vector<Event> events;
+
+}
+
+/**
+ * Get the current time
+ * @return Nanoseconds on CLOCK_MONOTONIC
+ */
+static int64_t now() {
+    timespec ts {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+/**
+ * Map the stats file, creating it if it doesn't exist. It is mapped once, and kept for the life of the process.
+ * @return The stages, or nullptr if the file could not be mapped
+ */
+static Stage *mapStages() {
+    static Stage *stages = [] () -> Stage* {
+        constexpr size_t size = sizeof(Header) + sizeof(Stage) * STATS_STAGES;
+
+        const int fd = Runtime::open(STATS_NAME, O_RDWR | O_CREAT);
+        if (fd == -1) { return nullptr; }
+
+        struct stat info {};
+        if (fstat(fd, &info) != 0 || (static_cast<size_t>(info.st_size) < size && ftruncate(fd, size) != 0)) {
+            close(fd);
+            return nullptr;
+        }
+
+        void *page = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (page == MAP_FAILED) { return nullptr; }
+
+        // A new file, or one from an older version - start over
+        auto *header = static_cast<Header*>(page);
+        if (header->magic != STATS_MAGIC || header->stages != STATS_STAGES) {
+            memset(page, 0, size);
+            header->stages = STATS_STAGES;
+            header->magic = STATS_MAGIC;
+        }
+
+        return reinterpret_cast<Stage*>(header + 1);
+    }();
+
+    return stages;
+}
+
+/**
+ * Add a duration to the stats of a stage
+ * @param name Name of the stage
+ * @param duration Duration in nanoseconds
+ */
+static void record(const std::string_view name, const int64_t duration) {
+    Stage *stages = mapStages();
+    if (stages == nullptr) { return; }
+
+    // A hash of 0 marks a free slot
+    const uint64_t hash = fnv(name.data(), name.size()) | 1;
+
+    for (size_t i = 0, pos = hash % STATS_STAGES; i < STATS_STAGES; ++i, pos = (pos + 1) % STATS_STAGES) {
+        Stage &stage = stages[pos];
+
+        uint64_t key = stage.key.load(std::memory_order_relaxed);
+        if (key == 0 && stage.key.compare_exchange_strong(key, hash)) {
+            // Claimed a free slot. Readers skip it until the name is filled in.
+            const size_t len = std::min<size_t>(name.size(), STATS_NAME_LEN - 1);
+            memcpy(stage.name, name.data(), len);
+            key = hash;
+        }
+        if (key != hash) { continue; }
+
+        const uint64_t us = std::min<int64_t>(duration / 1000, UINT32_MAX);
+        const uint64_t index = stage.count.fetch_add(1, std::memory_order_relaxed) % STATS_PROMPTS;
+        stage.samples[index].store(static_cast<uint32_t>(us), std::memory_order_relaxed);
+        return;
+    }
+}
+
+Trace::Span::Span(const std::string_view name) : name(name), start(now()) {}
+
+void Trace::Span::stop() {
+    if (!running) { return; }
+    running = false;
+
+    const int64_t duration = now() - start;
+    record(name, duration);
+
+    if (tracing.load(std::memory_order_relaxed)) {
+        const std::lock_guard guard(events_lock);
+        events.push_back({std::move(name), start, duration, gettid()});
+    }
+}
+
+void Trace::enable() { tracing = true; }
+
+bool Trace::dump(const string &path) {
+    FILE *file = fopen(path.c_str(), "we");
+    if (file == nullptr) {
+        perror("promptly: could not open trace file");
+        return false;
+    }
+
+    const std::lock_guard guard(events_lock);
+    const pid_t pid = getpid();
+
+    // Timestamps are in microseconds. Stage names are all our own, so they never need escaping.
+    fprintf(file, "{\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"promptly\"}}",
+            pid, pid);
+    for (const Event &event : events) {
+        fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+                event.name.c_str(), event.start / 1000.0, event.duration / 1000.0, pid, event.tid);
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+    const bool ok = !ferror(file);
+    if (fclose(file) != 0 || !ok) {
+        perror("promptly: could not write trace file");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Format a duration for --stats
+ * @param us Duration in microseconds
+ * @return The duration, in whichever unit keeps it short
+ */
+static string formatDuration(const uint32_t us) {
+    char buf[16];
+    if (us < 1000) { snprintf(buf, sizeof buf, "%uus", us); }
+    else if (us < 1'000'000) { snprintf(buf, sizeof buf, "%.1fms", us / 1e3); }
+    else { snprintf(buf, sizeof buf, "%.2fs", us / 1e6); }
+    return buf;
+}
+
+int Trace::stats() {
+    Stage *stages = mapStages();
+    if (stages == nullptr) {
+        perror("promptly: could not map stats");
+        return 1;
+    }
+
+    struct Row {
+        string name;
+        uint64_t count;
+        uint32_t p50, p99, max;
+    };
+    std::vector<Row> rows;
+
+    for (size_t pos = 0; pos < STATS_STAGES; ++pos) {
+        const Stage &stage = stages[pos];
+        const uint64_t count = stage.count.load(std::memory_order_relaxed);
+        if (stage.key.load(std::memory_order_relaxed) == 0 || count == 0 || stage.name[0] == '\0') { continue; }
+
+        // Prompts may be recording right now, which only makes the window off by a sample or two
+        std::vector<uint32_t> samples(std::min<uint64_t>(count, STATS_PROMPTS));
+        for (size_t i = 0; i < samples.size(); ++i) { samples[i] = stage.samples[i].load(std::memory_order_relaxed); }
+        std::ranges::sort(samples);
+
+        const size_t last = samples.size() - 1;
+        rows.push_back({string{stage.name, strnlen(stage.name, STATS_NAME_LEN)}, count,
+                        samples[last * 50 / 100], samples[last * 99 / 100], samples[last]});
+    }
+
+    if (rows.empty()) {
+        printf("No prompts recorded yet\n");
+        return 0;
+    }
+
+    std::ranges::sort(rows, {}, &Row::name);
+
+    printf("Over the last %d prompts at most:\n", STATS_PROMPTS);
+    printf("%-*s %10s %10s %10s %10s\n", STATS_NAME_LEN, "stage", "total", "p50", "p99", "max");
+    for (const Row &row : rows) {
+        printf("%-*s %10llu %10s %10s %10s\n", STATS_NAME_LEN, row.name.c_str(),
+               static_cast<unsigned long long>(row.count), formatDuration(row.p50).c_str(),
+               formatDuration(row.p99).c_str(), formatDuration(row.max).c_str());
+    }
+
+    return 0;
+}
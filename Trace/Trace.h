@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using std::string;
+
+/**
+ * Timing of every collector and render stage. Each stage is timed with a Span, which always adds its duration to a
+ * shared memory page of recent durations, so promptly --stats can show the latency of every stage over the last
+ * STATS_PROMPTS prompts, across every process. When tracing is enabled, spans are also kept in memory, to be written
+ * out as a Chrome trace (see chrome://tracing or ui.perfetto.dev).
+ */
+class Trace {
+public:
+    /**
+     * Times a stage, from when it is made until stop() is called or it goes out of scope
+     */
+    class Span {
+        string name;
+        int64_t start;
+        bool running = true;
+    public:
+        /**
+         * @param name Name of the stage. Stages with the same name share their stats.
+         */
+        explicit Span(std::string_view name);
+        ~Span() { stop(); }
+
+        Span(const Span&) = delete;
+        Span &operator=(const Span&) = delete;
+
+        /**
+         * Stop timing, and record the span. Only the first call does anything.
+         */
+        void stop();
+    };
+
+    /**
+     * Keep every span from now on, for dump()
+     */
+    static void enable();
+
+    /**
+     * Write every span kept since enable() to a file, as Chrome trace event JSON
+     * @param path File to write
+     * @return false if the file could not be written
+     */
+    static bool dump(const string &path);
+
+    /**
+     * Print the latency of every stage over the last STATS_PROMPTS prompts
+     * @return exit code for the process
+     */
+    static int stats();
+};
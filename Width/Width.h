@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/**
+ * Works out how many terminal columns a string takes up. Escape sequences and control characters take up none,
+ * combining marks and other zero width codepoints take up none, East Asian wide characters and emoji take up two,
+ * and everything else takes up one.
+ *
+ * Plain ASCII is checked eight bytes at a time, so the common case of a path or a number barely costs more than
+ * its length. Everything else is a lookup in the two stage table generated by get_width_table.py.
+ */
+class Width {
+public:
+    /**
+     * @param str UTF-8 string, which may contain terminal escape sequences
+     * @return How many columns str takes up when printed
+     */
+    static constexpr size_t of(std::string_view str);
+
+    /**
+     * @param cp A single codepoint
+     * @return How many columns cp takes up when printed
+     */
+    static constexpr size_t of(char32_t cp);
+
+private:
+    static constexpr uint64_t ONES = 0x0101010101010101;
+    static constexpr uint64_t HIGHS = 0x8080808080808080;
+
+    /**
+     * Check if 8 bytes are all printable ASCII (0x20 to 0x7e), and so take up one column each
+     */
+    static constexpr bool printable(const uint64_t word) {
+        const uint64_t below = (word - ONES * 0x20) & ~word; // A byte below 0x20 (this includes escape)
+        const uint64_t del = word ^ ONES * 0x7f; // A byte that is 0x7f becomes 0
+        return ((word | below | ((del - ONES) & ~del)) & HIGHS) == 0;
+    }
+
+    /**
+     * Skip over a terminal escape sequence
+     * @param str String containing the sequence
+     * @param i Position of the escape character
+     * @return Position just past the end of the sequence
+     */
+    static constexpr size_t skipEscape(std::string_view str, size_t i);
+
+    /**
+     * Decode a single UTF-8 codepoint. Malformed sequences decode to U+FFFD, one byte at a time.
+     * @param str String containing the codepoint
+     * @param i Position of the codepoint's first byte. Moved to just past its last byte.
+     * @return The codepoint
+     */
+    static constexpr char32_t decode(std::string_view str, size_t &i);
+};
+
+#include "table.h"
+
+constexpr size_t Width::of(const char32_t cp) {
+    if (cp < 0x7f) return cp >= 0x20;
+    if (cp > 0x10ffff) return 1;
+
+    const uint8_t packed = width_blocks[width_index[cp >> 8]][(cp & 0xff) >> 2];
+    return packed >> (cp & 3) * 2 & 3;
+}
+
+constexpr size_t Width::skipEscape(const std::string_view str, size_t i) {
+    if (++i >= str.size()) return i;
+
+    switch (str[i++]) {
+        // CSI (colors, cursor movement, ...) ends on a byte from '@' to '~'
+        case '[':
+            while (i < str.size() && (str[i] < 0x40 || str[i] > 0x7e)) ++i;
+            return i < str.size() ? i + 1 : i;
+        // OSC (titles, hyperlinks, ...) ends on BEL or ESC '\'
+        case ']':
+            while (i < str.size() && str[i] != '\a' && str[i] != '\033') ++i;
+            if (i < str.size() && str[i] == '\033') ++i;
+            return i < str.size() ? i + 1 : i;
+        // Everything else is the escape and a single character
+        default:
+            return i;
+    }
+}
+
+constexpr char32_t Width::decode(const std::string_view str, size_t &i) {
+    const auto byte = [&](const size_t at) { return static_cast<unsigned char>(str[at]); };
+    const auto cont = [&](const size_t at) { return (byte(at) & 0xc0) == 0x80; };
+
+    const unsigned char lead = byte(i);
+    const size_t left = str.size() - i;
+
+    if ((lead & 0xe0) == 0xc0 && left >= 2 && cont(i + 1)) {
+        const char32_t cp = (lead & 0x1f) << 6 | (byte(i + 1) & 0x3f);
+        i += 2;
+        return cp;
+    }
+    if ((lead & 0xf0) == 0xe0 && left >= 3 && cont(i + 1) && cont(i + 2)) {
+        const char32_t cp = (lead & 0x0f) << 12 | (byte(i + 1) & 0x3f) << 6 | (byte(i + 2) & 0x3f);
+        i += 3;
+        return cp;
+    }
+    if ((lead & 0xf8) == 0xf0 && left >= 4 && cont(i + 1) && cont(i + 2) && cont(i + 3)) {
+        const char32_t cp = (lead & 0x07) << 18 | (byte(i + 1) & 0x3f) << 12 | (byte(i + 2) & 0x3f) << 6
+                          | (byte(i + 3) & 0x3f);
+        i += 4;
+        return cp;
+    }
+
+    ++i;
+    return 0xfffd;
+}
+
+constexpr size_t Width::of(const std::string_view str) {
+    size_t width = 0;
+
+    for (size_t i = 0; i < str.size();) {
+        const auto chr = static_cast<unsigned char>(str[i]);
+
+        if (chr >= 0x80) { width += of(decode(str, i)); continue; }
+
+        if !consteval {
+            // Plain ASCII, eight bytes at a time
+            if (uint64_t word; i + 8 <= str.size() && (memcpy(&word, str.data() + i, 8), printable(word))) {
+                i += 8;
+                width += 8;
+                continue;
+            }
+        }
+
+        if (chr == '\033') { i = skipEscape(str, i); }
+        else { width += chr >= 0x20 && chr != 0x7f; ++i; }
+    }
+
+    return width;
+}
@@ -0,0 +1,71 @@
+#include "bench.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+
+/**
+ * Get every registered suite, by name
+ */
+static std::map<string, Bench::Suite> &suites() {
+    static std::map<string, Bench::Suite> all;
+    return all;
+}
+
+bool Bench::add(const char *name, const Suite suite) {
+    suites().emplace(name, suite);
+    return true;
+}
+
+void Bench::report(const string &name, const Result &result) {
+    printf("%-48s %14.1f ns/op %10.1f allocs/op %8.1f syscalls/op\n", name.c_str(), result.ns, result.allocs,
+           result.syscalls);
+    fflush(stdout);
+}
+
+string Bench::scratch() {
+    static std::vector<string> dirs;
+
+    const char *tmp = getenv("TMPDIR");
+    string path = string{tmp != nullptr && *tmp ? tmp : "/tmp"} + "/promptly_bench.XXXXXX";
+    if (mkdtemp(path.data()) == nullptr) {
+        perror("promptly_bench: mkdtemp");
+        exit(1);
+    }
+
+    if (dirs.empty()) {
+        atexit([] {
+            std::error_code err;
+            for (const auto &dir : dirs) std::filesystem::remove_all(dir, err);
+        });
+    }
+    dirs.push_back(path);
+
+    return path;
+}
+
+int main(const int argc, char **argv) {
+    if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
+        printf("usage: %s [suite [args...]]\nsuites:\n", argv[0]);
+        for (const auto &[name, suite] : suites()) printf("    %s\n", name.c_str());
+        return 0;
+    }
+
+    if (argc > 1) {
+        const auto suite = suites().find(argv[1]);
+        if (suite == suites().end()) {
+            fprintf(stderr, "%s: no such suite: %s\n", argv[0], argv[1]);
+            return 1;
+        }
+
+        suite->second({argv + 2, argv + argc});
+        return 0;
+    }
+
+    for (const auto &[name, suite] : suites()) {
+        printf("== %s ==\n", name.c_str());
+        suite({});
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::string;
+
+// How long (in milliseconds) to keep running a function when timing it
+#define BENCH_MIN_TIME 200
+
+/**
+ * A tiny benchmark harness. Every suite registers itself with Bench::add(), and is run by name from the command line:
+ *
+ *     promptly_bench [suite [args...]]
+ *
+ * Running without a suite runs every suite with its default arguments.
+ *
+ * Along with the time, every result has the number of heap allocations and syscalls per run. Both are counted across
+ * every thread, by replacing operator new and wrapping the libc syscall functions (see counters.cpp).
+ */
+class Bench {
+public:
+    using Suite = void (*)(const std::vector<string> &args);
+
+    struct Result {
+        double ns; // Time per run, in nanoseconds
+        double allocs; // Heap allocations per run
+        double syscalls; // Syscalls per run
+    };
+
+    // Running totals, kept by counters.cpp
+    static std::atomic<uint64_t> allocs;
+    static std::atomic<uint64_t> syscalls;
+
+    /**
+     * Register a suite. Meant to be called from a static initializer, e.g.
+     * `static bool added = Bench::add("name", run);`
+     * @param name Name the suite is run by
+     * @param suite The suite
+     * @return true
+     */
+    static bool add(const char *name, Suite suite);
+
+    /**
+     * Time a function. It is run until it has taken at least BENCH_MIN_TIME in total, and at least min_runs times.
+     * Runs are done in batches that double in size, so reading the clock doesn't skew the result for fast functions.
+     * @param fn The function to time
+     * @param min_runs The least number of times to run fn
+     * @return The average time, allocations and syscalls of a run
+     */
+    template <typename F>
+    static Result time(F fn, size_t min_runs = 1) {
+        using steady = std::chrono::steady_clock;
+
+        size_t runs = 0;
+        const uint64_t allocs_start = allocs.load(std::memory_order_relaxed);
+        const uint64_t syscalls_start = syscalls.load(std::memory_order_relaxed);
+        const auto start = steady::now();
+        auto elapsed = steady::duration::zero();
+
+        for (size_t batch = 1; runs < min_runs || elapsed < std::chrono::milliseconds(BENCH_MIN_TIME); batch *= 2) {
+            for (size_t i = 0; i < batch; ++i) fn();
+            runs += batch;
+            elapsed = steady::now() - start;
+        }
+
+        const auto per_run = [runs](const double total) { return total / static_cast<double>(runs); };
+        return {
+            per_run(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())),
+            per_run(static_cast<double>(allocs.load(std::memory_order_relaxed) - allocs_start)),
+            per_run(static_cast<double>(syscalls.load(std::memory_order_relaxed) - syscalls_start))
+        };
+    }
+
+    /**
+     * Print a single result
+     * @param name What was measured
+     * @param result The result, as returned by time()
+     */
+    static void report(const string &name, const Result &result);
+
+    /**
+     * Create a scratch directory, which is removed along with everything in it when the benchmark exits
+     * @return Path of the directory
+     */
+    static string scratch();
+};
@@ -0,0 +1,233 @@
+#include "bench.h"
+
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "Buffer/Buffer.h"
+#include "Context/Context.h"
+#include "Element/Element.h"
+#include "Path/Path.h"
+#include "Prompt/Prompt.h"
+#include "Root/Root.h"
+
+// Depth of the deep directory tree, and how many entries are in the wide directory
+#define DEEP_DEPTH 24
+#define WIDE_ENTRIES 10'000
+
+// Every system file the collectors read, other than the power supplies
+static const char *const system_files[] = {
+    "/proc/stat", "/proc/meminfo", "/proc/pressure/memory", "/proc/sys/kernel/random/boot_id", "/etc/os-release",
+    "/var/run/utmp"
+};
+
+/**
+ * Create a directory along with any missing parents
+ */
+static void makeDirs(const string &path) {
+    for (size_t pos = path.find('/', 1); pos != string::npos; pos = path.find('/', pos + 1)) {
+        mkdir(path.substr(0, pos).c_str(), 0700);
+    }
+    mkdir(path.c_str(), 0700);
+}
+
+/**
+ * Write a file, creating the directories it is in
+ */
+static void writeFile(const string &path, const std::string_view data) {
+    makeDirs(path.substr(0, path.rfind('/')));
+
+    const int fd = open(path.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd == -1 || write(fd, data.data(), data.size()) != static_cast<ssize_t>(data.size())) {
+        fprintf(stderr, "collectors: could not write %s\n", path.c_str());
+    }
+    close(fd);
+}
+
+/**
+ * Read a whole file
+ * @return The contents of the file, or nothing if it could not be read
+ */
+static std::optional<string> readFile(const string &path) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) { return {}; }
+
+    string data;
+    char buf[4096];
+    for (ssize_t got; (got = read(fd, buf, sizeof buf)) > 0; ) { data.append(buf, got); }
+    close(fd);
+
+    return data;
+}
+
+/**
+ * Copy the system files the collectors read on this machine into a directory, to be replayed later
+ * @param root Directory to record into
+ */
+static void record(const string &root) {
+    for (const char *file : system_files) {
+        if (const auto data = readFile(file)) { writeFile(root + file, *data); }
+    }
+
+    // Power supplies are symlinks into the device tree, only their uevent is kept
+    if (DIR *dir = opendir("/sys/class/power_supply")) {
+        while (const dirent *entry = readdir(dir)) {
+            if (entry->d_name[0] == '.') { continue; }
+            const string uevent = string{"/sys/class/power_supply/"} + entry->d_name + "/uevent";
+            if (const auto data = readFile(uevent)) { writeFile(root + uevent, *data); }
+        }
+        closedir(dir);
+    }
+}
+
+/**
+ * Fill a directory with made up system files: a 16 core machine, two batteries of different sizes, a mains supply
+ * and a battery powered mouse, and an empty utmp file
+ * @param root Directory to fill
+ */
+static void synthesize(const string &root) {
+    string stat = "cpu  1393280 32966 572056 13343292 6130 0 17875 0 23933 0\n";
+    for (int core = 0; core < 16; ++core) {
+        stat += "cpu" + std::to_string(core) + " 87080 2060 35753 833955 383 0 1117 0 1495 0\n";
+    }
+    stat += "intr 199292231 9 0 0 0 0 0 0 0 1 0 0 0 0\nctxt 366437960\nbtime 1717000000\nprocesses 401201\n";
+    writeFile(root + "/proc/stat", stat);
+
+    writeFile(root + "/proc/meminfo",
+              "MemTotal:       32768000 kB\nMemFree:         1024000 kB\nMemAvailable:   12288000 kB\n"
+              "Buffers:          512000 kB\nCached:          9216000 kB\nSwapCached:        20480 kB\n"
+              "SwapTotal:       8192000 kB\nSwapFree:        7168000 kB\n");
+    writeFile(root + "/proc/pressure/memory",
+              "some avg10=1.25 avg60=0.50 avg300=0.10 total=123456\nfull avg10=0.00 avg60=0.00 avg300=0.00 total=0\n");
+    writeFile(root + "/proc/sys/kernel/random/boot_id", "0b5e7c3e-6b1f-4bb6-9d0c-1b2c3d4e5f60\n");
+    writeFile(root + "/etc/os-release", "PRETTY_NAME=\"Arch Linux\"\nNAME=\"Arch Linux\"\nID=arch\nBUILD_ID=rolling\n");
+    writeFile(root + "/var/run/utmp", "");
+
+    writeFile(root + "/sys/class/power_supply/BAT0/uevent",
+              "POWER_SUPPLY_NAME=BAT0\nPOWER_SUPPLY_TYPE=Battery\nPOWER_SUPPLY_STATUS=Discharging\n"
+              "POWER_SUPPLY_PRESENT=1\nPOWER_SUPPLY_ENERGY_FULL=50000000\nPOWER_SUPPLY_ENERGY_NOW=31000000\n"
+              "POWER_SUPPLY_CAPACITY=62\n");
+    writeFile(root + "/sys/class/power_supply/BAT1/uevent",
+              "POWER_SUPPLY_NAME=BAT1\nPOWER_SUPPLY_TYPE=Battery\nPOWER_SUPPLY_STATUS=Unknown\n"
+              "POWER_SUPPLY_PRESENT=1\nPOWER_SUPPLY_ENERGY_FULL=23000000\nPOWER_SUPPLY_ENERGY_NOW=20000000\n"
+              "POWER_SUPPLY_CAPACITY=86\n");
+    writeFile(root + "/sys/class/power_supply/AC/uevent",
+              "POWER_SUPPLY_NAME=AC\nPOWER_SUPPLY_TYPE=Mains\nPOWER_SUPPLY_ONLINE=0\n");
+    writeFile(root + "/sys/class/power_supply/hidpp_battery_0/uevent",
+              "POWER_SUPPLY_NAME=hidpp_battery_0\nPOWER_SUPPLY_TYPE=Battery\nPOWER_SUPPLY_SCOPE=Device\n"
+              "POWER_SUPPLY_CAPACITY=40\n");
+}
+
+/**
+ * Create a chain of depth directories, each with a sibling sharing most of its name, so every element of the path
+ * has to be minimized
+ * @param home Directory to create the chain in
+ * @param depth How many directories deep to go
+ * @return Path of the deepest directory
+ */
+static string deepTree(const string &home, const size_t depth) {
+    string path = home;
+    char name[32];
+
+    for (size_t level = 0; level < depth; ++level) {
+        snprintf(name, sizeof name, "directory_%02zu_b", level);
+        mkdir((path + "/" + name).c_str(), 0700);
+        snprintf(name, sizeof name, "directory_%02zu_a", level);
+        path += string{"/"} + name;
+        mkdir(path.c_str(), 0700);
+    }
+
+    return path;
+}
+
+/**
+ * Create a directory holding count entries, all sharing a prefix with the directory the shell is in
+ * @param home Directory to create it in
+ * @param count Number of entries
+ * @return Path of the directory the shell is in
+ */
+static string wideTree(const string &home, const size_t count) {
+    const string dir = home + "/wide";
+    mkdir(dir.c_str(), 0700);
+
+    char name[32];
+    for (size_t i = 0; i < count; ++i) {
+        snprintf(name, sizeof name, "entry_%07zu", i);
+        close(open((dir + "/" + name).c_str(), O_CREAT | O_WRONLY | O_CLOEXEC, 0600));
+    }
+
+    const string target = dir + "/entry_target";
+    mkdir(target.c_str(), 0700);
+    return target;
+}
+
+/**
+ * Run every collector on its own, then minimize a deep and a wide path, and then render the whole prompt. The system
+ * files are read from a fake root, and runtime files go to a scratch directory.
+ * @param args A root to read the system files from, as made by "collectors record DIR". If no root is given, a made
+ * up one is used.
+ */
+static void run(const std::vector<string> &args) {
+    if (args.size() == 2 && args[0] == "record") {
+        record(args[1]);
+        return;
+    }
+
+    const string scratch = Bench::scratch();
+    string root = scratch + "/root";
+    if (args.empty()) { synthesize(root); }
+    else { root = args[0]; }
+
+    if (!Root::set(root)) {
+        fprintf(stderr, "collectors: could not open root %s\n", root.c_str());
+        return;
+    }
+    // Keep our caches apart from the ones real prompts use
+    makeDirs(scratch + "/runtime");
+    setenv("XDG_RUNTIME_DIR", (scratch + "/runtime").c_str(), 1);
+
+    const string home = scratch + "/home/user";
+    makeDirs(home);
+
+    Context ctx;
+    ctx.width = 120;
+    ctx.sid = getsid(0);
+    ctx.tty = "pts/0";
+    ctx.home = home;
+    ctx.pwd = deepTree(home, DEEP_DEPTH);
+    ctx.status = {"0", "1"};
+
+    for (const char *name : {"user_host", "time", "cpu", "mem", "bat", "python", "icon", "status", "git"}) {
+        Bench::report(string{"collect "} + name, Bench::time([&] {
+            Element element;
+            Prompt::collect(name, ctx, element);
+        }));
+    }
+
+    Bench::report("path " + std::to_string(DEEP_DEPTH) + " deep", Bench::time([&] {
+        Element element;
+        Path::collect(ctx).addPath(element, 40);
+    }));
+
+    Context wide = ctx;
+    wide.pwd = wideTree(home, WIDE_ENTRIES);
+    Bench::report("path " + std::to_string(WIDE_ENTRIES) + " wide", Bench::time([&] {
+        Element element;
+        Path::collect(wide).addPath(element, 40);
+    }));
+
+    static Buffer out;
+    Bench::report("render", Bench::time([&] {
+        out.clear();
+        Prompt::render(ctx, out);
+    }));
+
+    Root::set("");
+}
+
+static bool added = Bench::add("collectors", run);
@@ -0,0 +1,171 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdlib>
+#include <new>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+std::atomic<uint64_t> Bench::allocs = 0;
+std::atomic<uint64_t> Bench::syscalls = 0;
+
+// === Allocations ===
+// Every other form of operator new (arrays, nothrow) ends up in one of these two.
+
+void *operator new(const size_t size) {
+    Bench::allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = malloc(size == 0 ? 1 : size)) { return ptr; }
+    throw std::bad_alloc();
+}
+
+void *operator new(const size_t size, const std::align_val_t align) {
+    Bench::allocs.fetch_add(1, std::memory_order_relaxed);
+    const auto alignment = static_cast<size_t>(align);
+    // aligned_alloc wants the size to be a non-zero multiple of the alignment
+    const size_t rounded = std::max<size_t>((size + alignment - 1) / alignment, 1) * alignment;
+    if (void *ptr = aligned_alloc(alignment, rounded)) { return ptr; }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { free(ptr); }
+
+// === Syscalls ===
+// The libc functions that wrap the syscalls the collectors make are replaced with ones that count the call, and then
+// call the real function. Only calls made from outside libc are seen: libc calling itself (e.g. opendir() calling
+// openat()) goes straight to the real function. So opendir() is counted as a single call, and the getdents64 calls
+// readdir() makes are missed.
+
+// Count a call, and look up the real function. It is looked up once, on the first call.
+#define REAL(name) \
+    Bench::syscalls.fetch_add(1, std::memory_order_relaxed); \
+    static const auto real = reinterpret_cast<decltype(&::name)>(dlsym(RTLD_NEXT, #name))
+
+extern "C" {
+
+int open(const char *path, const int flags, ...) {
+    va_list args;
+    va_start(args, flags);
+    const mode_t mode = flags & (O_CREAT | O_TMPFILE) ? va_arg(args, mode_t) : 0;
+    va_end(args);
+
+    REAL(open);
+    return real(path, flags, mode);
+}
+
+int openat(const int dir, const char *path, const int flags, ...) {
+    va_list args;
+    va_start(args, flags);
+    const mode_t mode = flags & (O_CREAT | O_TMPFILE) ? va_arg(args, mode_t) : 0;
+    va_end(args);
+
+    REAL(openat);
+    return real(dir, path, flags, mode);
+}
+
+int close(const int fd) {
+    REAL(close);
+    return real(fd);
+}
+
+ssize_t read(const int fd, void *buf, const size_t size) {
+    REAL(read);
+    return real(fd, buf, size);
+}
+
+ssize_t pread(const int fd, void *buf, const size_t size, const off_t offset) {
+    REAL(pread);
+    return real(fd, buf, size, offset);
+}
+
+ssize_t write(const int fd, const void *buf, const size_t size) {
+    REAL(write);
+    return real(fd, buf, size);
+}
+
+int stat(const char *path, struct stat *info) noexcept {
+    REAL(stat);
+    return real(path, info);
+}
+
+int lstat(const char *path, struct stat *info) noexcept {
+    REAL(lstat);
+    return real(path, info);
+}
+
+int fstat(const int fd, struct stat *info) noexcept {
+    REAL(fstat);
+    return real(fd, info);
+}
+
+int fstatat(const int dir, const char *path, struct stat *info, const int flags) noexcept {
+    REAL(fstatat);
+    return real(dir, path, info, flags);
+}
+
+int access(const char *path, const int mode) noexcept {
+    REAL(access);
+    return real(path, mode);
+}
+
+int faccessat(const int dir, const char *path, const int mode, const int flags) noexcept {
+    REAL(faccessat);
+    return real(dir, path, mode, flags);
+}
+
+ssize_t readlink(const char *path, char *buf, const size_t size) noexcept {
+    REAL(readlink);
+    return real(path, buf, size);
+}
+
+DIR *opendir(const char *path) {
+    REAL(opendir);
+    return real(path);
+}
+
+DIR *fdopendir(const int fd) {
+    REAL(fdopendir);
+    return real(fd);
+}
+
+void *mmap(void *addr, const size_t size, const int prot, const int flags, const int fd, const off_t offset) noexcept {
+    REAL(mmap);
+    return real(addr, size, prot, flags, fd, offset);
+}
+
+int munmap(void *addr, const size_t size) noexcept {
+    REAL(munmap);
+    return real(addr, size);
+}
+
+int flock(const int fd, const int op) noexcept {
+    REAL(flock);
+    return real(fd, op);
+}
+
+int gethostname(char *name, const size_t size) noexcept {
+    REAL(gethostname);
+    return real(name, size);
+}
+
+// Used for the syscalls libc has no function for, like getdents64. Every syscall takes at most 6 arguments.
+long syscall(const long number, ...) noexcept {
+    va_list args;
+    va_start(args, number);
+    long arg[6];
+    for (long &value : arg) { value = va_arg(args, long); }
+    va_end(args);
+
+    REAL(syscall);
+    return real(number, arg[0], arg[1], arg[2], arg[3], arg[4], arg[5]);
+}
+
+}
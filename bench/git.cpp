@@ -0,0 +1,119 @@
+#include "bench.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "Git/Git.h"
+
+// How many files to put in each directory of the generated repository
+#define FILES_PER_DIR 1000
+
+static void put32(string &out, const uint32_t value) {
+    const char bytes[] = {
+        static_cast<char>(value >> 24), static_cast<char>(value >> 16), static_cast<char>(value >> 8),
+        static_cast<char>(value)
+    };
+    out.append(bytes, 4);
+}
+
+/**
+ * Generate a repository with a clean work tree: count files in directories of FILES_PER_DIR, and a version 2 index
+ * holding their stat data. Object hashes are left zeroed, as the index is only ever compared by stat data.
+ * @param root Directory to create the repository in
+ * @param count Number of files to create
+ */
+static void generate(const string &root, const size_t count) {
+    mkdir(root.c_str(), 0700);
+    mkdir((root + "/.git").c_str(), 0700);
+
+    const int head = open((root + "/.git/HEAD").c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0600);
+    write(head, "ref: refs/heads/main\n", 21);
+    close(head);
+
+    string index = "DIRC";
+    put32(index, 2);
+    put32(index, count);
+
+    char name[48];
+    for (size_t i = 0; i < count; ++i) {
+        if (i % FILES_PER_DIR == 0) {
+            snprintf(name, sizeof name, "d%04zu", i / FILES_PER_DIR);
+            mkdir((root + "/" + name).c_str(), 0700);
+        }
+
+        snprintf(name, sizeof name, "d%04zu/f%07zu", i / FILES_PER_DIR, i);
+        const string path = root + "/" + name;
+        const int fd = open(path.c_str(), O_CREAT | O_WRONLY | O_CLOEXEC, 0644);
+        write(fd, name, strlen(name));
+        close(fd);
+
+        struct stat info {};
+        stat(path.c_str(), &info);
+
+        const size_t start = index.size();
+        put32(index, info.st_ctim.tv_sec);
+        put32(index, info.st_ctim.tv_nsec);
+        put32(index, info.st_mtim.tv_sec);
+        put32(index, info.st_mtim.tv_nsec);
+        put32(index, info.st_dev);
+        put32(index, info.st_ino);
+        put32(index, info.st_mode);
+        put32(index, info.st_uid);
+        put32(index, info.st_gid);
+        put32(index, info.st_size);
+        index.append(20, '\0');
+        index += static_cast<char>(strlen(name) >> 8);
+        index += static_cast<char>(strlen(name));
+        index += name;
+
+        // Pad with NULs to a multiple of 8, with at least one NUL
+        index.append(8 - (index.size() - start) % 8, '\0');
+    }
+
+    // The hash of the whole index, which is never checked
+    index.append(20, '\0');
+
+    const int fd = open((root + "/.git/index").c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, 0600);
+    write(fd, index.data(), index.size());
+    close(fd);
+}
+
+/**
+ * Get the status of generated repositories of increasing size.
+ * @param args Repository sizes to test. Defaults to 10k and 100k files, and 500k takes a while to generate.
+ */
+static void run(const std::vector<string> &args) {
+    std::vector<size_t> sizes;
+    for (const auto &arg : args) sizes.push_back(std::stoul(arg));
+    if (sizes.empty()) sizes = {10'000, 100'000};
+
+    const string root = Bench::scratch();
+
+    for (const size_t size : sizes) {
+        const string repo = root + "/" + std::to_string(size);
+        generate(repo, size);
+
+        const string label = "git " + std::to_string(size) + " files";
+        const string dir = repo + "/d0000";
+
+        if (const auto git = Git::collect(dir, false); !git || git->dirty || git->untracked) {
+            fprintf(stderr, "git: generated repository of %zu files is not clean\n", size);
+        }
+
+        Bench::report(label + " clean, uncached", Bench::time([&] { Git::collect(dir, false); }, 3));
+        Bench::report(label + " clean, cached", Bench::time([&] { Git::collect(dir); }, 3));
+
+        // The first file in the index is modified, so checking can stop right away
+        const string first = repo + "/d0000/f0000000";
+        const int fd = open(first.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+        write(fd, "x", 1);
+        close(fd);
+
+        Bench::report(label + " dirty, uncached", Bench::time([&] { Git::collect(dir, false); }, 3));
+    }
+}
+
+static bool added = Bench::add("git", run);
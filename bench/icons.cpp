@@ -0,0 +1,37 @@
+#include "bench.h"
+
+#include <map>
+
+#include "icons.h"
+
+/**
+ * Compare the compile-time icon table against the std::map it replaced. The map has to be built at startup,
+ * so every run of promptly paid for building it, on top of the lookup.
+ * @param args Distro name to look up. Defaults to "archlinux".
+ */
+static void run(const std::vector<string> &args) {
+    const string name = args.empty() ? "archlinux" : args[0];
+
+    // Keep the compiler from throwing away results
+    volatile size_t sink = 0;
+
+    Bench::report("icons std::map build + lookup", Bench::time([&] {
+        std::map<string, string> map;
+        for (const Icon &icon : icons)
+            if (!icon.name.empty()) map.emplace(icon.name, icon.icon);
+        const auto icon = map.find(name);
+        sink = sink + (icon == map.end() ? 0 : icon->second.size());
+    }));
+
+    std::map<string, string> map;
+    for (const Icon &icon : icons)
+        if (!icon.name.empty()) map.emplace(icon.name, icon.icon);
+
+    Bench::report("icons std::map lookup", Bench::time([&] {
+        const auto icon = map.find(name);
+        sink = sink + (icon == map.end() ? 0 : icon->second.size());
+    }));
+    Bench::report("icons IconTable lookup", Bench::time([&] { sink = sink + icons.find(name).size(); }));
+}
+
+static bool added = Bench::add("icons", run);
@@ -0,0 +1,148 @@
+#include "bench.h"
+
+#include <iterator>
+#include <utility>
+
+#include "List/List.h"
+
+// The linked list List replaced, kept to compare against. The original never freed its nodes, which would leak
+// gigabytes over a benchmark run, so this copy gains a destructor.
+namespace linked {
+
+template <typename T>
+class List;
+
+template <typename T>
+class Node {
+    friend class List<T>;
+    T data;
+    [[nodiscard]] std::string _toString(std::string str) const {
+        str += data;
+        if (next != nullptr) return next->_toString(str);
+        return str;
+    }
+    [[nodiscard]] std::string _toString(std::string str, const std::string& sep) const {
+        str += data;
+        if (next->next != nullptr) return next->_toString(str + sep, sep);
+        return str;
+    }
+public:
+    Node* next = nullptr;
+    Node() = default;
+    explicit Node(T& data) : data(data) {}
+    T& operator*() { return data; }
+    [[nodiscard]] std::string toString() const { return this->_toString(""); };
+    [[nodiscard]] std::string toString(const std::string& sep) const { return this->_toString("", sep); };
+};
+
+template <typename T>
+class Iter {
+    Node<T>* pos;
+
+public:
+    explicit Iter(Node<T>* pos) : pos(pos) {}
+    Iter() : pos(nullptr) {}
+    explicit Iter(const Node<T>* pos) : pos(pos) {}
+    using difference_type = std::ptrdiff_t;
+    using value_type = T;
+
+    Iter& operator++() { pos = pos->next; return *this; }
+
+    Iter operator++(int) {
+        Iter tmp(pos);
+        ++pos;
+        return tmp;
+    }
+
+    [[nodiscard]] Node<T> *peek() const { return pos->next; }
+
+    bool operator==(const Iter & end) const { return end.pos == this->pos; }
+    T& operator*() const { return **pos; }
+
+    [[nodiscard]] std::string toString() const { return pos->toString(); }
+    [[nodiscard]] std::string toString(const std::string& sep) const { return pos->toString(sep); };
+};
+
+template <typename T>
+class List {
+    Node<T>* head = nullptr;
+    Node<T>* tail = nullptr;
+
+    T* (List::*_append)(T&) = &List::append_first;
+
+    T* append_first(T &value) {
+        head = new Node<T>(value);
+        tail = head->next = new Node<T>();
+        _append = &List::append_subsequent;
+        return &head->data;
+    }
+
+    T* append_subsequent(T &value) {
+        **tail = value;
+        T *ptr = &tail->data;
+        tail = tail->next = new Node<T>();
+        return ptr;
+    }
+
+public:
+    List() = default;
+    ~List() {
+        while (head != nullptr) delete std::exchange(head, head->next);
+    }
+    Iter<T> begin() const { return Iter(head); }
+    Iter<T> end() const { return Iter<T>(tail); }
+    T* Append(T value) {
+        return (this->*_append)(value);
+    }
+
+    [[nodiscard]] std::string toString() const { return head->toString(); }
+    [[nodiscard]] std::string toString(const std::string& sep) const { return head->toString(sep); };
+};
+
+} // namespace linked
+
+/**
+ * Build a list of path elements and join it, the way Path::addPath does for every prompt
+ * @param names Path elements to put in the list
+ * @return The joined path
+ */
+template <typename L>
+static string build(const std::vector<string> &names) {
+    L list;
+    for (const string &name : names) list.Append(name);
+
+    // Walk the list once, like the shrinking pass does
+    size_t total = 0;
+    for (const string &name : list) total += name.size();
+    if (total == 0) return "";
+
+    return list.toString("/");
+}
+
+/**
+ * Compare List against the linked list it replaced.
+ * @param args How many path elements to put in each list. Defaults to 6, and 32 to show growing past the inline storage.
+ */
+static void run(const std::vector<string> &args) {
+    std::vector<size_t> counts;
+    for (const string &arg : args) counts.push_back(std::stoul(arg));
+    if (counts.empty()) counts = {6, 32};
+
+    // Keep the compiler from throwing away results
+    volatile size_t sink = 0;
+
+    for (const size_t count : counts) {
+        std::vector<string> names;
+        for (size_t i = 0; i < count; ++i) names.push_back("dir" + std::to_string(i));
+
+        const string n = std::to_string(count);
+        Bench::report(("list linked " + n + " elements"), Bench::time([&] {
+            sink = sink + build<linked::List<string>>(names).size();
+        }));
+        Bench::report(("list contiguous " + n + " elements"), Bench::time([&] {
+            sink = sink + build<List<string>>(names).size();
+        }));
+    }
+}
+
+static bool added = Bench::add("list", run);
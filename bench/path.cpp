@@ -0,0 +1,96 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "Path/Path.h"
+
+/**
+ * The readdir() based engine Path::shortest() replaced, kept as a baseline.
+ */
+static size_t readdirShortest(const char *dir, const string &name) {
+    size_t min = 1;
+
+    DIR *dp = opendir(dir);
+    if (dp == nullptr) { return 0; }
+
+    struct stat dir_info {};
+    fstatat(dirfd(dp), name.c_str(), &dir_info, 0);
+
+    while (const dirent *ep = readdir(dp)) {
+        if (ep->d_ino == dir_info.st_ino) continue;
+
+        const size_t max = std::min(name.size(), strlen(ep->d_name));
+
+        for (size_t i = 0; i < max; ++i) {
+            if (ep->d_name[i] != name[i]) {
+                if (i >= min) min = i + 1;
+                break;
+            }
+
+            if (i >= min) min = i + 1;
+        }
+    }
+    closedir(dp);
+
+    return min;
+}
+
+/**
+ * Create a directory full of empty files named entry_0000000, entry_0000001, ...
+ * @param dir Directory to create
+ * @param count Number of files to create
+ */
+static void fill(const string &dir, const size_t count) {
+    mkdir(dir.c_str(), 0700);
+
+    char name[32];
+    for (size_t i = 0; i < count; ++i) {
+        snprintf(name, sizeof name, "entry_%07zu", i);
+        close(openat(AT_FDCWD, (dir + "/" + name).c_str(), O_CREAT | O_WRONLY | O_CLOEXEC, 0600));
+    }
+}
+
+/**
+ * Minimize a path element in directories of increasing size, with both the old readdir() engine and
+ * the getdents64 engine.
+ * @param args Directory sizes to test. Defaults to 10k, 100k and 1M entries.
+ */
+static void run(const std::vector<string> &args) {
+    std::vector<size_t> sizes;
+    for (const auto &arg : args) sizes.push_back(std::stoul(arg));
+    if (sizes.empty()) sizes = {10'000, 100'000, 1'000'000};
+
+    const string root = Bench::scratch();
+
+    for (const size_t size : sizes) {
+        const string dir = root + "/" + std::to_string(size);
+        fill(dir, size);
+        const int dir_fd = open(dir.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+
+        // entry_target shares "entry_" with every other entry, so the whole directory has to be read.
+        // entry_000000 is a prefix of entry_0000001, so it can't be shortened at all, and reading can stop early.
+        for (const string name : {"entry_target", "entry_000000"}) {
+            close(openat(AT_FDCWD, (dir + "/" + name).c_str(), O_CREAT | O_WRONLY | O_CLOEXEC, 0600));
+
+            const size_t expect = readdirShortest(dir.c_str(), name);
+            if (const size_t got = Path::shortest(dir_fd, name); got != expect) {
+                fprintf(stderr, "path: %s in %zu entries: getdents64 gave %zu, readdir gave %zu\n",
+                        name.c_str(), size, got, expect);
+            }
+
+            const string label = "path " + std::to_string(size) + " " + name;
+            Bench::report(label + " readdir", Bench::time([&] { readdirShortest(dir.c_str(), name); }, 3));
+            Bench::report(label + " getdents64", Bench::time([&] { Path::shortest(dir_fd, name); }, 3));
+        }
+
+        close(dir_fd);
+    }
+}
+
+static bool added = Bench::add("path", run);
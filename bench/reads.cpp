@@ -0,0 +1,56 @@
+#include "bench.h"
+
+#include <cstdio>
+#include <fcntl.h>
+
+#include "Reader/Reader.h"
+#include "Ring/Ring.h"
+
+// Largest file that is read
+#define READS_BUF 4096
+
+/**
+ * Read the files a prompt reads, a few at a time and all at once, with plain syscalls and with io_uring. The files are
+ * read from the real root, as the point is how the kernel answers.
+ * @param args Files to read. Defaults to the files the cpu, memory and battery collectors read.
+ */
+static void run(const std::vector<string> &args) {
+    std::vector<string> paths = args;
+    if (paths.empty()) {
+        paths = {"/proc/stat", "/proc/meminfo", "/proc/pressure/memory", "/etc/os-release",
+                 "/proc/sys/kernel/random/boot_id"};
+    }
+
+    std::vector<char> bufs(paths.size() * READS_BUF);
+    std::vector<Ring::Read> reads(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        reads[i] = {AT_FDCWD, paths[i].c_str(), bufs.data() + i * READS_BUF, READS_BUF, 0};
+    }
+
+    if (!Ring::available()) { fprintf(stderr, "reads: io_uring is not available, only plain reads are timed\n"); }
+
+    // Both ways have to be able to read every file
+    if (Ring::read(reads.data(), reads.size())) {
+        char plain[READS_BUF];
+        for (const Ring::Read &read : reads) {
+            const size_t got = Reader::read(read.path, plain, sizeof plain).size();
+            if ((read.result > 0) != (got > 0)) {
+                fprintf(stderr, "reads: %s: io_uring gave %zd, a plain read gave %zu bytes\n", read.path, read.result, got);
+            }
+        }
+    }
+
+    for (const size_t count : {size_t{2}, paths.size()}) {
+        const string label = "reads " + std::to_string(count) + " files";
+
+        Bench::report(label + " plain", Bench::time([&] {
+            for (size_t i = 0; i < count; ++i) { Reader::read(reads[i].path, reads[i].buf, READS_BUF); }
+        }));
+
+        if (Ring::available()) {
+            Bench::report(label + " io_uring", Bench::time([&] { Ring::read(reads.data(), count); }));
+        }
+    }
+}
+
+static bool added = Bench::add("reads", run);
@@ -0,0 +1,43 @@
+#include "bench.h"
+
+#include "Sgr/Sgr.h"
+
+/**
+ * Build something shaped like a rendered prompt: segments that each reset and set their own colors around a bit of
+ * text, with separators in between
+ * @param count How many segments to put in it
+ */
+static string prompt(const size_t count) {
+    string str;
+    for (size_t i = 0; i < count; ++i) {
+        str += "\033[0m\033[49m\033[39m\033[38;5;240m\033[0m\033[49m ";
+        str += "\033[38;5;" + std::to_string(100 + i % 100) + "m\033[1mseg" + std::to_string(i) + "\033[0m\033[49m";
+        str += "\033[39m\033[0m";
+    }
+    return str;
+}
+
+/**
+ * Compact the SGR sequences in prompts of a few sizes, and report how much smaller they get
+ * @param args How many segments to put in the largest prompt. Defaults to 64.
+ */
+static void run(const std::vector<string> &args) {
+    const size_t count = args.empty() ? 64 : std::stoul(args[0]);
+
+    // Keep the compiler from throwing away results
+    volatile size_t sink = 0;
+
+    for (const size_t segments : {size_t{8}, count}) {
+        const string original = prompt(segments);
+        string str;
+        const size_t size = Sgr::compact(string{original}.data(), original.size());
+
+        const string label = "sgr " + std::to_string(original.size()) + "B -> " + std::to_string(size) + "B";
+        Bench::report(label, Bench::time([&] {
+            str = original;
+            sink = sink + Sgr::compact(str.data(), str.size());
+        }));
+    }
+}
+
+static bool added = Bench::add("sgr", run);
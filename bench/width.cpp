@@ -0,0 +1,59 @@
+#include "bench.h"
+
+#include <string_view>
+
+#include "Width/Width.h"
+
+/**
+ * The byte loop Width replaced, kept as a baseline. It skips escape sequences and UTF-8 continuation bytes, and
+ * counts everything else as one column.
+ */
+static size_t byteLoop(const std::string_view str) {
+    size_t result = 0;
+    bool term_seq = false;
+
+    for (const char chr : str) {
+        if (term_seq) { if (chr == 'm') term_seq = false; }
+        else if (chr == '\033') { term_seq = true; }
+        else if ((chr & 0xc0) != 0x80) result++;
+    }
+
+    return result;
+}
+
+/**
+ * Build a long path by repeating a path element
+ * @param element Path element to repeat
+ * @param count How many times to repeat it
+ */
+static string path(const string &element, const size_t count) {
+    string str;
+    for (size_t i = 0; i < count; ++i) str += "/" + element;
+    return str;
+}
+
+/**
+ * Measure the width of long paths, with both the old byte loop and Width.
+ * @param args How many path elements to put in each path. Defaults to 64.
+ */
+static void run(const std::vector<string> &args) {
+    const size_t count = args.empty() ? 64 : std::stoul(args[0]);
+
+    const std::pair<const char *, string> cases[] = {
+        {"ascii", path("projects", count)},
+        {"cjk", path("日本語のディレクトリ", count)},
+        {"mixed", path("café-ünïcödé", count)},
+        {"colored", path("\033[38;5;246msrc\033[0m", count)},
+    };
+
+    // Keep the compiler from throwing away results
+    volatile size_t sink = 0;
+
+    for (const auto &[name, str] : cases) {
+        const string label = "width " + string{name} + " " + std::to_string(str.size()) + "B";
+        Bench::report(label + " byte loop", Bench::time([&] { sink = sink + byteLoop(str); }));
+        Bench::report(label + " Width", Bench::time([&] { sink = sink + Width::of(str); }));
+    }
+}
+
+static bool added = Bench::add("width", run);
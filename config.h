@@ -0,0 +1,136 @@
+#pragma once
+
+// === Memory page information ===
+// the name of the shared memory page, and it's mode. Also applies to the semaphore.
+#define PAGE_NAME "/promptly"
+#define PAGE_MODE 0666
+
+// Name of the shared memory page holding session identities (user, host, ssh status and distro icon), and how many
+// sessions it holds. The uid is appended to the name.
+#define ID_PAGE_NAME "/promptly.id"
+#define ID_SLOTS 64
+
+// === Config file ===
+// Where the config file is, under $XDG_CONFIG_HOME (or ~/.config if it is unset). Settings it doesn't change keep the
+// defaults from this file and term.h (see Config).
+#define CONFIG_PATH "promptly/config"
+
+// === Runtime files ===
+// Files that are kept between prompts are created in $XDG_RUNTIME_DIR, or in /tmp (suffixed with the uid)
+// if $XDG_RUNTIME_DIR is unset.
+
+// Name of the daemon's unix socket.
+#define SOCK_NAME "promptly.sock"
+// How long (in milliseconds) the client waits on the daemon before falling back to rendering the prompt itself.
+#define SOCK_TIMEOUT 250
+
+// Name of the cache of minimized path elements, and how many elements it holds.
+#define MIN_CACHE_NAME "promptly.mincache"
+#define MIN_CACHE_SLOTS 4096
+
+// Name of the compiled config file, which is rebuilt whenever the config file changes.
+#define CONFIG_CACHE_NAME "promptly.config"
+
+// Name of the file listing the batteries, which is only refreshed once per boot.
+#define BAT_CACHE_NAME "promptly.bat"
+// How long (in seconds) finding no batteries at all is trusted for. A battery that is plugged in later, or that the
+// kernel hadn't found yet, shows up within this long.
+#define BAT_EMPTY_AGE 30
+
+// Name of the cache of git results, and how many repositories it holds.
+#define GIT_CACHE_NAME "promptly.git"
+#define GIT_CACHE_SLOTS 64
+
+// Name of the file holding the last element every collector produced, how many elements it holds, and the most bytes
+// of an element it can hold. Together with the rest of an entry, SAVED_SIZE makes each entry 256 bytes.
+#define SAVED_NAME "promptly.saved"
+#define SAVED_SLOTS 256
+#define SAVED_SIZE 237
+
+// Name of the file holding how long every stage of the recent prompts took (see promptly --stats), how many stages it
+// holds, and how many prompts back it reaches.
+#define STATS_NAME "promptly.stats"
+#define STATS_STAGES 32
+#define STATS_PROMPTS 1024
+
+// === Collector information ===
+// How many threads to run the segment collectors on. There are only a handful of collectors, and most of their time
+// is spent waiting on the kernel, so this doesn't need to match the number of cores.
+#define POOL_SIZE 4
+// How many threads to run the collectors that walk the filesystem (the path and git) on, and how many that may grow
+// to. They are kept apart from the other collectors, so one hung on a network filesystem can't leave the others
+// without a thread. Every cwd gets collectors of its own, so each directory hung on takes one more thread, up to the
+// limit.
+#define FS_POOL_SIZE 2
+#define FS_POOL_LIMIT 16
+// How long (in milliseconds) to wait on a collector that reads from the filesystem. If it takes any longer, the value
+// it produced for the last prompt is shown instead, and it is left to finish in the background.
+#define SEGMENT_TIMEOUT 20
+// How long (in milliseconds) a refresh started by promptly --async waits on the collectors that are slow enough to be
+// left out of the first prompt (see Prompt::render).
+#define ASYNC_TIMEOUT 5000
+// Whether collectors that read several files at once (e.g. the memory usage and pressure) read them all through
+// io_uring, with a single syscall. If the kernel doesn't allow it, they are read one at a time no matter what. Off by
+// default: procfs and sysfs can't be read without blocking, so io_uring hands every read to a worker thread, which
+// costs more than the syscalls it saves (see promptly_bench reads).
+#define READ_URING 0
+
+// === CPU sampler ===
+// The sampler reads the cpu counters in the background (see promptly --sampler), so the usage shown covers a fixed
+// window of time. Without it, the usage is whatever happened since the last prompt.
+
+// Name of the shared memory page holding the samples. The uid is appended to the name.
+#define CPU_PAGE_NAME "/promptly.cpu"
+// How often (in milliseconds) to sample the counters.
+#define CPU_INTERVAL 250
+// How far back (in milliseconds) the usage shown in the prompt reaches.
+#define CPU_WINDOW 1000
+// How many samples to keep. Must hold at least CPU_WINDOW / CPU_INTERVAL + 2 samples.
+#define CPU_RING 16
+// Most cores to keep track of. Any cores past this are still counted in the total, but can't be the hottest core.
+#define CPU_MAX_CORES 256
+// If the busiest core is at least this busy (in percent), it is shown next to the total. Can be set with cpu_hot in the
+// config file.
+#define CPU_HOT 90
+
+// === Memory information ===
+// Size of the buffer /proc/meminfo is read into. It is read with a single read, so this must fit all of it.
+#define MEM_BUF 4096
+
+// === Git information ===
+// How long (in milliseconds) a clean work tree, or the result of looking for untracked files, is reused for while the
+// index doesn't change. A modified file is reused until the index changes. Checking a clean tree again means a stat of
+// every tracked file, which adds up in a large repository (about 600 ms for 500k files), so a check that took long is
+// reused for GIT_CACHE_SCALE times as long as it took instead, up to GIT_CACHE_MAX. That keeps checking to about 2% of
+// the time at most. The tradeoff is that an edit made in the meantime only shows up once the result runs out.
+#define GIT_CACHE_AGE 2000
+#define GIT_CACHE_SCALE 50
+#define GIT_CACHE_MAX 60000
+// Most directory entries to look at when looking for untracked files. Large repositories are only partly searched.
+#define GIT_UNTRACKED_MAX 4096
+
+// === Output information ===
+// Size of the buffer a prompt is rendered into. Anything past this is cut off.
+#define OUT_BUF_SIZE (64 * 1024)
+
+// === Time information ===
+// Format for the time display. Can be set with time_format in the config file.
+
+// "%T" is equivalent to "%H:%M:%S"
+#define TIME_FORMAT "%T"
+// How many characters to allocate for the time, including the terminating NUL. A time that doesn't fit is left out.
+#define TIME_LEN 64
+
+// === Battery limits ===
+// At what charge level to change the color of the battery indicator. The largest parameter that is larger or equal to
+// the current battery level will be applied. BAT_HIGH must be 100. The others can be set with bat_alarm, bat_warn and
+// bat_normal in the config file.
+
+// Indicator will be red and blinking. If battery is charging, this will not apply and will fall back to BAT_WARN.
+#define BAT_ALARM 5
+// Indicator will be red.
+#define BAT_WARN 15
+// Indicator will be yellow.
+#define BAT_NORMAL 80
+// Indicator will be green
+#define BAT_HIGH 100
@@ -7,20 +7,21 @@ touch icons.h
 cat << EOF > icons.h
 #pragma once
 
-#include <map>
-#include <string>
+#include "IconTable/IconTable.h"
 
-static const std::map<std::string, std::string> icons = {
+// Generated by get_nix_codepoint.bash. The perfect hash for the table is built by the compiler.
+static constexpr IconTable icons {{
 EOF
 
 curl "https://www.nerdfonts.com/cheat-sheet" | grep -oP '.*nf-linux-\K.+' | while read -r i; do
-  name="$(echo "$i" | grep -oP '^[^"]+' | tr -d ' ' | tr -d '-' | tr -d '_' )"
+  # Names are normalized the same way IconTable normalizes lookups: no ' ', '-' or '_', and all lowercase
+  name="$(echo "$i" | grep -oP '^[^"]+' | tr -d ' ' | tr -d '-' | tr -d '_' | tr '[:upper:]' '[:lower:]')"
   codepoint="$(echo $i | grep -oP '[^"]+"[^"]*$' | grep -oP '^[^"]+')"
   echo "    { \"$name\", \"\u$codepoint\" }," >> icons.h
 done
 
 cat << EOF >> icons.h
-};
+}};
 EOF
 
 # If it exists, use clang-format to prettify icons.h
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""
+Generate Width/table.h, the display width of every codepoint, from Python's Unicode database.
+
+The table has two stages. Codepoints are split into blocks of 256, and most blocks are the same as some other block
+(all width 1, all wide, ...), so each distinct block is only stored once. width_index maps a block number to the
+distinct block, and width_blocks holds every distinct block, 2 bits per codepoint.
+"""
+
+import unicodedata
+
+BLOCK = 256
+
+
+def zero(cp):
+    # Control characters, combining marks, enclosing marks and format characters (zero width joiners, bidi marks, ...)
+    # take up no space. The soft hyphen is the exception, as terminals draw it.
+    if cp == 0xad:
+        return False
+    # Hangul medial vowels and final consonants join onto the syllable before them
+    if 0x1160 <= cp <= 0x11ff:
+        return True
+    return unicodedata.category(chr(cp)) in ("Mn", "Me", "Cf", "Cc")
+
+
+def wide(cp):
+    if unicodedata.category(chr(cp)) == "Cn":
+        return False
+    return unicodedata.east_asian_width(chr(cp)) in ("W", "F")
+
+
+def width(cp):
+    if zero(cp):
+        return 0
+    return 2 if wide(cp) else 1
+
+
+blocks = {}
+index = []
+for start in range(0, 0x110000, BLOCK):
+    block = tuple(width(cp) for cp in range(start, start + BLOCK))
+    index.append(blocks.setdefault(block, len(blocks)))
+
+assert len(blocks) <= 256, "block numbers no longer fit in a byte"
+
+with open("Width/table.h", "w") as out:
+    out.write("#pragma once\n\n")
+    out.write("#include <cstdint>\n\n")
+    out.write(f"// Generated by get_width_table.py from Unicode {unicodedata.unidata_version}. Don't edit by hand.\n\n")
+
+    out.write(f"// The distinct block each block of {BLOCK} codepoints uses\n")
+    out.write(f"inline constexpr uint8_t width_index[{len(index)}] = {{\n")
+    for row in range(0, len(index), 16):
+        out.write("    " + " ".join(f"{i:3}," for i in index[row:row + 16]) + "\n")
+    out.write("};\n\n")
+
+    out.write("// Every distinct block, 2 bits per codepoint with the lowest codepoint in the lowest bits\n")
+    out.write(f"inline constexpr uint8_t width_blocks[{len(blocks)}][{BLOCK // 4}] = {{\n")
+    for block in blocks:
+        packed = [sum(block[i + j] << (2 * j) for j in range(4)) for i in range(0, BLOCK, 4)]
+        out.write("    {" + ", ".join(f"0x{b:02x}" for b in packed) + "},\n")
+    out.write("};\n")
@@ -0,0 +1,36 @@
+# promptly for bash. Source this from .bashrc, with promptly on $PATH.
+#
+# The prompt is drawn right away, without waiting on the slow segments (e.g. git). promptly writes the full prompt
+# to a file once they are done, and sends us SIGUSR1.
+#
+# Unlike zsh, bash can't show the full prompt in place: it only runs the trap once the line being edited is done,
+# and readline can't be told to redraw the prompt from outside. What the refresh still buys is that the slow segments
+# are ready by the time the next prompt is drawn, instead of that prompt having to wait on them again.
+
+# The prompt file goes in a directory only we can write to, or another user could put something of theirs in its
+# place. Without one, prompts aren't refreshed.
+_promptly_dir="$(promptly --runtime-dir)"
+_promptly_file="$_promptly_dir/promptly.$$.prompt"
+_promptly_prompt=''
+
+_promptly_command() {
+    local codes=("${PIPESTATUS[@]}")
+    if [[ -n $_promptly_dir ]]; then
+        _promptly_prompt="$(PROMPTLY_SHELL=bash promptly --async "signal:$$:$_promptly_file" "${codes[@]}")"
+    else
+        _promptly_prompt="$(PROMPTLY_SHELL=bash promptly "${codes[@]}")"
+    fi
+}
+
+_promptly_refresh() {
+    [[ -r $_promptly_file ]] && _promptly_prompt="$(<"$_promptly_file")"
+}
+
+trap _promptly_refresh USR1
+trap '[[ -n $_promptly_dir ]] && rm -f -- "$_promptly_file" "$_promptly_file.pid"' EXIT
+
+# Has to run first, before anything else in PROMPT_COMMAND changes $PIPESTATUS
+PROMPT_COMMAND="_promptly_command${PROMPT_COMMAND:+;$PROMPT_COMMAND}"
+# PROMPTLY_SHELL=bash has the prompt come out ready for this, with escape sequences inside \001 \002 (what \[ \]
+# turns into), so readline doesn't count them as columns
+PS1='${_promptly_prompt}'
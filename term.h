@@ -1,8 +1,8 @@
 #pragma once
 
-#include <string>
+#include <string_view>
 
-using std::string;
+#include "Literal/Literal.h"
 
 #define genSEQ(str) ("\033[" str "m")
 #define genFG(str) (genSEQ("38;5;" str))
@@ -10,47 +10,20 @@ using std::string;
 #define DEFAULT_FG "246"
 #define DEFAULT_BG "236"
 
-/**
- * Calculate the length of a string as number of characters displayed.
- * Handles Unicode multibyte chars as well as terminal escape sequences
- * @param str The string to count
- * @return The number of characters that would be displayed if the string were printed
- */
-static constexpr size_t u_strlen(const string& str) {
-    size_t result = 0;
-
-    bool term_seq = false;
-
-    for (const char chr : str) {
-        // terminal sequences are exited when we reach an 'm' character
-        if (term_seq) { if (chr == 'm') term_seq = false; }
-        // terminal sequences start with the '\033' char
-        else if (chr == '\033') {term_seq = true; }
-
-        // Any byte that starts with the bits "10" is an extension
-        // of a utf-8 character (the first bit in a multibyte utf-8
-        // char starts w/ "11", and a non multibyte char starts w/ "0")
-        // so we skip everything that starts w/ "10"
-        else if ( (chr & 0xc0) != 0x80) result++;
-    }
-
-    return result;
-}
-
 struct fore {
-    static constexpr string WHITE      = genFG("7");
-    static constexpr string LIGHT_BLUE = genFG("6");
-    static constexpr string DARK_BLUE  = genFG("4");
-    static constexpr string RED        = genFG("1");
-    static constexpr string YELLOW     = genFG("3");
-    static constexpr string GREEN      = genFG("2");
-    static constexpr string DEFAULT    = genFG(DEFAULT_FG);
-    static constexpr string BG_DEFAULT = genFG(DEFAULT_BG);
+    static constexpr Literal WHITE      = genFG("7");
+    static constexpr Literal LIGHT_BLUE = genFG("6");
+    static constexpr Literal DARK_BLUE  = genFG("4");
+    static constexpr Literal RED        = genFG("1");
+    static constexpr Literal YELLOW     = genFG("3");
+    static constexpr Literal GREEN      = genFG("2");
+    static constexpr Literal DEFAULT    = genFG(DEFAULT_FG);
+    static constexpr Literal BG_DEFAULT = genFG(DEFAULT_BG);
 };
 
 struct back {
-    static constexpr string WHITE      = "\033[48;5;7m";
-    static constexpr string DEFAULT    = genBG(DEFAULT_BG);
+    static constexpr Literal WHITE      = "\033[48;5;7m";
+    static constexpr Literal DEFAULT    = genBG(DEFAULT_BG);
 };
 
 struct chars {
@@ -58,21 +31,21 @@ struct chars {
     // And it is (probably) easier/more reformat to store them as a string,
     // instead of a char16_t that will need to be converted back into a 2-byte u8 char
     // every time it needs to be added to a segment.
-    static constexpr string R_SEP = "\ue0b3";
-    static constexpr size_t R_SEP_LEN = u_strlen(R_SEP);
-    static constexpr string M_SEP = "\u00b7";
-    static constexpr string L_SEP = "\ue0b1";
-    static constexpr size_t L_SEP_LEN = u_strlen(L_SEP);
-    static constexpr string CPU = "\uf4bc";
-    static constexpr string MEM = "\uefc5";
-    static constexpr string CLOCK = "\uf017";
-    static constexpr string PYTHON = "\ue73c";
-    static constexpr string FOLDER = "\uf115";
-    static constexpr string LOCK = "\uf023";
-    static constexpr string HOME = "\uf015";
+    static constexpr Literal R_SEP = "\ue0b3";
+    static constexpr Literal M_SEP = "\u00b7";
+    static constexpr Literal L_SEP = "\ue0b1";
+    static constexpr Literal CPU = "\uf4bc";
+    static constexpr Literal MEM = "\uefc5";
+    static constexpr Literal CLOCK = "\uf017";
+    static constexpr Literal PYTHON = "\ue73c";
+    static constexpr Literal FOLDER = "\uf115";
+    static constexpr Literal LOCK = "\uf023";
+    static constexpr Literal HOME = "\uf015";
+    static constexpr Literal PENDING = "\u2026";
+    static constexpr Literal BRANCH = "\ue0a0";
 };
 
-inline string bat_drain[] = {
+inline constexpr std::string_view bat_drain[] = {
     "󱃍",
     "󰁺",
     "󰁻",
@@ -86,7 +59,7 @@ inline string bat_drain[] = {
     "󰁹"
 };
 
-inline string bat_charge[] = {
+inline constexpr std::string_view bat_charge[] = {
     "󰢟",
     "󰢜",
     "󰂆",
@@ -101,8 +74,8 @@ inline string bat_charge[] = {
 };
 
 struct ctrl {
-    static constexpr string RESET    = genSEQ("0");
-    static constexpr string RESET_FG = genSEQ("39");
-    static constexpr string RESET_BG = genSEQ("49");
-    static constexpr string BLINK    = genSEQ("5");
+    static constexpr Literal RESET    = genSEQ("0");
+    static constexpr Literal RESET_FG = genSEQ("39");
+    static constexpr Literal RESET_BG = genSEQ("49");
+    static constexpr Literal BLINK    = genSEQ("5");
 };
\ No newline at end of file